@@ -23,6 +23,10 @@ struct AdjVector {
     for (u32 c : vec) f(c);
   }
 
+  inline void prefetch_clauses_of_not_literal(u32 literal) const {
+    __builtin_prefetch((*literals_to_clauses)[literal ^ 1u].data());
+  }
+
   template<class F>
   inline void for_each_literal_in_clause(u32 cid, F&& f) const {
     const auto& lits = (*clauses_to_literals)[cid];
@@ -70,6 +74,10 @@ struct AdjCSR {
     for (u32 p = b; p < e; ++p) f(lit_edges[p]);
   }
 
+  inline void prefetch_clauses_of_not_literal(u32 literal) const {
+    __builtin_prefetch(&lit_edges[lit_off[literal ^ 1u]]);
+  }
+
   template<class F>
   inline void for_each_literal_in_clause(u32 cid, F&& f) const {
     u32 b = cl_off[cid], e = cl_off[cid + 1];
@@ -0,0 +1,335 @@
+// A digit-bitboard solver, to compare representations with the literal-graph SCC solvers on
+// the same datasets. The board is nine candidate bitboards, one per digit, each a 128-bit
+// vector with one band per 32-bit lane: bits 0-26 of lane b are rows 3b..3b+2, 9 bits per row,
+// so cell (row * 9 + col) is bit (cell - 27 * b) of lane b, and lane 3 is unused. A digit keeps
+// its bit in the cell where it's placed, and a separate board tracks the unsolved cells.
+// Propagation is repeated to a fixpoint:
+//  - naked singles: the nine boards are added up bit-sliced, giving the unsolved cells with at
+//    least one and at least two candidates, and so the cells with one (and the empty ones, a
+//    conflict). the same counts find the bivalue cells to branch on.
+//  - hidden singles: a digit with one place left in a row, column or box.
+//  - locked candidates: within a band, a digit fills one cell in each of the three rows and of
+//    the three boxes, in the box-row segments of one of the 6 permutations of boxes to rows.
+//    the segments where it can still go are mapped through a table to the union of the
+//    permutations they contain, and the board is cut down to those. this covers pointing and
+//    claiming and a bit more. stacks are handled the same way, with columns for rows.
+// Branching takes a bivalue cell if there is one and otherwise a cell with the fewest
+// candidates, found through a cell-candidate view transposed from the digit boards. Trying the
+// cell's candidates in turn is a chain of binary branches (this digit, or one of the rest), and
+// like the SCC solvers and tdoku we count a guess per binary branch: one per candidate but the
+// last, so a bivalue cell is one guess.
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+
+typedef uint32_t Bands __attribute__((vector_size(16)));
+
+constexpr uint32_t kBandBits = 0x7ffffffu;
+// the cells of the first row of a band, and those of the first column of a band or box.
+constexpr uint32_t kRowBits = 0x1ffu;
+constexpr uint32_t kColSpread = 1u | 1u << 9u | 1u << 18u;
+
+inline bool Any(const Bands &bands) {
+    return (bands[0] | bands[1] | bands[2]) != 0;
+}
+
+inline int Popcount(const Bands &bands) {
+    return __builtin_popcount(bands[0]) + __builtin_popcount(bands[1]) +
+           __builtin_popcount(bands[2]);
+}
+
+inline bool Single(uint32_t bits) {
+    return bits != 0 && (bits & (bits - 1)) == 0;
+}
+
+struct Tables {
+    array<Bands, 81> cell{};
+    // each cell's row, column and box, less the cell itself.
+    array<Bands, 81> peers{};
+    // for a digit's box-line segments within a band or stack (bit 3 * line + box), the union
+    // of the permutations of boxes to lines among them, or 0 if there are none.
+    array<uint16_t, 512> permutations{};
+
+    Tables() {
+        for (int i = 0; i < 81; i++) {
+            cell[i] = Bands{};
+            cell[i][i / 27] = 1u << (uint32_t) (i % 27);
+        }
+        for (int i = 0; i < 81; i++) {
+            peers[i] = Bands{};
+            for (int j = 0; j < 81; j++) {
+                bool same_row = i / 9 == j / 9, same_col = i % 9 == j % 9;
+                bool same_box = i / 27 == j / 27 && i % 9 / 3 == j % 9 / 3;
+                if (j != i && (same_row || same_col || same_box)) peers[i] |= cell[j];
+            }
+        }
+        const int kOrders[6][3] = {{0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0}};
+        for (int segments = 0; segments < 512; segments++) {
+            for (const auto &order : kOrders) {
+                uint16_t placement = 0;
+                for (int line = 0; line < 3; line++) placement |= 1u << (3u * line + order[line]);
+                if ((segments & placement) == placement) permutations[segments] |= placement;
+            }
+        }
+    }
+};
+
+const Tables &GetTables() {
+    static const Tables tables;
+    return tables;
+}
+
+struct Board {
+    array<Bands, 9> digits;
+    Bands unsolved;
+};
+
+struct SolverBitboard {
+    const Tables &tables_ = GetTables();
+    size_t limit_ = 1;
+    size_t num_solutions_ = 0;
+    size_t num_guesses_ = 0;
+    char solution_[81]{};
+
+    // places digit in cell, if it's still a candidate there.
+    bool Place(int cell, int digit, Board *board) {
+        const Bands &bit = tables_.cell[cell];
+        if (!Any(board->digits[digit] & board->unsolved & bit)) return false;
+        board->unsolved &= ~bit;
+        for (auto &digit_bits : board->digits) digit_bits &= ~bit;
+        board->digits[digit] = (board->digits[digit] & ~tables_.peers[cell]) | bit;
+        return true;
+    }
+
+    // places digit in each cell of cells.
+    bool PlaceAll(const Bands &cells, int digit, Board *board) {
+        for (int lane = 0; lane < 3; lane++) {
+            for (uint32_t bits = cells[lane]; bits; bits &= bits - 1) {
+                if (!Place(lane * 27 + __builtin_ctz(bits), digit, board)) return false;
+            }
+        }
+        return true;
+    }
+
+    // candidate counts over the unsolved cells, bit-sliced: cells with at least one, two and
+    // three candidates.
+    static void CountCandidates(const Board &board, Bands *ones, Bands *twos, Bands *threes) {
+        *ones = *twos = *threes = Bands{};
+        for (const Bands &digit_bits : board.digits) {
+            Bands candidates = digit_bits & board.unsolved;
+            *threes |= *twos & candidates;
+            *twos |= *ones & candidates;
+            *ones |= candidates;
+        }
+    }
+
+    bool NakedSingles(Board *board, bool *progress) {
+        Bands ones, twos, threes;
+        CountCandidates(*board, &ones, &twos, &threes);
+        if (Any(board->unsolved & ~ones)) return false;
+        Bands singles = ones & ~twos;
+        if (!Any(singles)) return true;
+        *progress = true;
+        for (int digit = 0; digit < 9; digit++) {
+            if (!PlaceAll(singles & board->digits[digit], digit, board)) return false;
+        }
+        return true;
+    }
+
+    // the cells where digit is the only candidate left in a row, column or box that it hasn't
+    // been placed in.
+    static bool HiddenSingles(const Bands &digit_bits, const Bands &unsolved, Bands *singles) {
+        *singles = Bands{};
+        Bands columns{};
+        for (int lane = 0; lane < 3; lane++) {
+            uint32_t bits = digit_bits[lane];
+            for (uint32_t line = 0; line < 3; line++) {
+                uint32_t row = bits & (kRowBits << (9u * line));
+                uint32_t box = bits & ((7u * kColSpread) << (3u * line));
+                if (row == 0 || box == 0) return false;
+                if (Single(row)) (*singles)[lane] |= row;
+                if (Single(box)) (*singles)[lane] |= box;
+            }
+        }
+        for (uint32_t col = 0; col < 9; col++) {
+            Bands column = digit_bits & (kColSpread << col);
+            int count = Popcount(column);
+            if (count == 0) return false;
+            if (count == 1) columns |= column;
+        }
+        *singles = (*singles | columns) & unsolved;
+        return true;
+    }
+
+    // cuts a digit's board down to the box-row segments of some permutation in every band, and
+    // to the box-column segments of some permutation in every stack.
+    bool LockedCandidates(Bands *digit_bits) {
+        Bands &bits = *digit_bits;
+        for (int lane = 0; lane < 3; lane++) {
+            uint32_t band = bits[lane];
+            uint32_t spread = band | band >> 1u | band >> 2u;
+            uint32_t segments = 0;
+            for (uint32_t line = 0; line < 3; line++) {
+                for (uint32_t box = 0; box < 3; box++) {
+                    segments |= ((spread >> (9u * line + 3u * box)) & 1u) << (3u * line + box);
+                }
+            }
+            uint32_t keep = tables_.permutations[segments];
+            if (keep == 0) return false;
+            uint32_t mask = 0;
+            for (uint32_t line = 0; line < 3; line++) {
+                for (uint32_t box = 0; box < 3; box++) {
+                    if ((keep >> (3u * line + box)) & 1u) mask |= 7u << (9u * line + 3u * box);
+                }
+            }
+            bits[lane] = band & mask;
+        }
+        // in a stack, the boxes are the bands and the lines its three columns.
+        array<uint32_t, 3> folded{};
+        for (int lane = 0; lane < 3; lane++) {
+            folded[lane] = (bits[lane] | bits[lane] >> 9u | bits[lane] >> 18u) & kRowBits;
+        }
+        array<uint32_t, 3> columns_kept{};
+        for (uint32_t stack = 0; stack < 3; stack++) {
+            uint32_t segments = 0;
+            for (uint32_t lane = 0; lane < 3; lane++) {
+                uint32_t lane_columns = (folded[lane] >> (3u * stack)) & 7u;
+                for (uint32_t col = 0; col < 3; col++) {
+                    segments |= ((lane_columns >> col) & 1u) << (3u * col + lane);
+                }
+            }
+            uint32_t keep = tables_.permutations[segments];
+            if (keep == 0) return false;
+            for (uint32_t lane = 0; lane < 3; lane++) {
+                for (uint32_t col = 0; col < 3; col++) {
+                    if ((keep >> (3u * col + lane)) & 1u) columns_kept[lane] |= 1u << (3u * stack + col);
+                }
+            }
+        }
+        for (int lane = 0; lane < 3; lane++) bits[lane] &= columns_kept[lane] * kColSpread;
+        return true;
+    }
+
+    bool Propagate(Board *board) {
+        while (Any(board->unsolved)) {
+            bool progress = false;
+            if (!NakedSingles(board, &progress)) return false;
+            if (progress) continue;
+            for (int digit = 0; digit < 9; digit++) {
+                Bands singles;
+                if (!HiddenSingles(board->digits[digit], board->unsolved, &singles)) return false;
+                if (Any(singles)) {
+                    progress = true;
+                    if (!PlaceAll(singles, digit, board)) return false;
+                }
+            }
+            if (progress) continue;
+            for (auto &digit_bits : board->digits) {
+                Bands before = digit_bits;
+                if (!LockedCandidates(&digit_bits)) return false;
+                progress |= Any(before ^ digit_bits);
+            }
+            if (!progress) return true;
+        }
+        return true;
+    }
+
+    // a bivalue cell if there is one, or else an unsolved cell with the fewest candidates.
+    int ChooseCell(const Board &board) {
+        Bands ones, twos, threes;
+        CountCandidates(board, &ones, &twos, &threes);
+        Bands bivalue = twos & ~threes;
+        for (int lane = 0; lane < 3; lane++) {
+            if (bivalue[lane]) return lane * 27 + __builtin_ctz(bivalue[lane]);
+        }
+        // the cell-candidate view: each cell's candidates as 9 bits.
+        array<uint16_t, 81> candidates{};
+        for (int digit = 0; digit < 9; digit++) {
+            Bands bits = board.digits[digit] & board.unsolved;
+            for (int lane = 0; lane < 3; lane++) {
+                for (uint32_t lane_bits = bits[lane]; lane_bits; lane_bits &= lane_bits - 1) {
+                    candidates[lane * 27 + __builtin_ctz(lane_bits)] |= 1u << (uint32_t) digit;
+                }
+            }
+        }
+        int best_cell = -1, best_count = 10;
+        for (int cell = 0; cell < 81; cell++) {
+            int count = __builtin_popcount(candidates[cell]);
+            if (count > 0 && count < best_count) {
+                best_cell = cell;
+                best_count = count;
+            }
+        }
+        return best_cell;
+    }
+
+    void RecordSolution(const Board &board) {
+        for (int digit = 0; digit < 9; digit++) {
+            for (int lane = 0; lane < 3; lane++) {
+                for (uint32_t bits = board.digits[digit][lane]; bits; bits &= bits - 1) {
+                    solution_[lane * 27 + __builtin_ctz(bits)] = (char) ('1' + digit);
+                }
+            }
+        }
+    }
+
+    void Search(Board *board) {
+        if (!Propagate(board)) return;
+        if (!Any(board->unsolved)) {
+            if (++num_solutions_ == 1) RecordSolution(*board);
+            return;
+        }
+        int cell = ChooseCell(*board);
+        int num_candidates = 0;
+        for (int digit = 0; digit < 9; digit++) {
+            num_candidates += Any(board->digits[digit] & tables_.cell[cell]);
+        }
+        for (int digit = 0; digit < 9; digit++) {
+            if (!Any(board->digits[digit] & tables_.cell[cell])) continue;
+            // the last candidate is what's left once the others have been tried, not a guess.
+            num_guesses_ += --num_candidates > 0;
+            Board guess = *board;
+            if (Place(cell, digit, &guess)) Search(&guess);
+            if (num_solutions_ == limit_) return;
+        }
+    }
+
+    bool InitializePuzzle(const char *input, bool pencilmark, Board *board) {
+        for (auto &digit_bits : board->digits) digit_bits = Bands{kBandBits, kBandBits, kBandBits, 0};
+        board->unsolved = Bands{kBandBits, kBandBits, kBandBits, 0};
+        for (int cell = 0; cell < 81; cell++) {
+            for (int digit = 0; digit < 9; digit++) {
+                if (pencilmark) {
+                    if (input[cell * 9 + digit] == '.') board->digits[digit] &= ~tables_.cell[cell];
+                } else if (input[cell] == '1' + digit) {
+                    if (!Place(cell, digit, board)) return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    size_t SolveSudoku(const char *input, size_t limit, char *solution, size_t *num_guesses) {
+        limit_ = limit;
+        num_solutions_ = 0;
+        num_guesses_ = 0;
+        Board board;
+        if (InitializePuzzle(input, input[81] >= '.', &board)) Search(&board);
+        if (num_solutions_ > 0) memcpy(solution, solution_, 81);
+        *num_guesses = num_guesses_;
+        return num_solutions_;
+    }
+};
+
+} // namespace
+
+extern "C" size_t DrakeSolverBitboard(
+    const char* input, size_t limit, uint32_t /*flags*/, char* solution, size_t* num_guesses) {
+  thread_local SolverBitboard solver;
+  return solver.SolveSudoku(input, limit, solution, num_guesses);
+}
@@ -0,0 +1,281 @@
+// The drake library's C API (see include/drake.h): the vectorized SoA solver behind a
+// single-puzzle entry point (plain or budgeted), a batch entry point and a parallel solution
+// counter. Built with -fno-exceptions -fno-rtti and hidden visibility into drake_static and
+// drake_shared.
+
+#include "include/drake.h"
+#include "triad_scc_core.hpp"
+#include "triad_scc_simd.hpp"
+#include "adjacency.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Solver = SolverDpllTriadScc<AdjCSR<kNumLiterals>, SimdKernels>;
+
+// setting up a solver's clauses and implication lists takes longer than most solves, so each
+// thread keeps one. it's too big for static thread-local storage, which matters when the
+// shared library is loaded with dlopen, so it lives on the heap.
+Solver &ThreadSolver() {
+    static thread_local std::unique_ptr<Solver> solver(new Solver());
+    return *solver;
+}
+
+// the number of threads to run for num_threads (as in the API) and this much work.
+int NumThreads(int num_threads, size_t num_tasks) {
+    if (num_threads <= 0) num_threads = (int) std::thread::hardware_concurrency();
+    return (int) std::min<size_t>((size_t) std::max(num_threads, 1),
+                                  std::max<size_t>(num_tasks, 1));
+}
+
+// the threads the batch and counting calls run on besides the caller's. they're kept between
+// calls, and with them their ThreadSolver, whose setup (about 770 usec) would otherwise be paid
+// by every worker of every call. calls made at the same time each take their own idle workers,
+// so the pool grows to the most threads ever in use at once.
+class WorkerPool {
+public:
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        for (auto &worker : workers_) worker->wake.notify_one();
+        for (auto &worker : workers_) worker->thread.join();
+    }
+
+    // runs work on num_threads threads, including the caller's, returning when all are done.
+    void Run(int num_threads, const std::function<void()> &work) {
+        Job job{&work, num_threads - 1};
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (int i = 1; i < num_threads; i++) {
+                if (idle_.empty()) {
+                    workers_.emplace_back(new Worker());
+                    Worker *worker = workers_.back().get();
+                    worker->thread = std::thread([this, worker]() { Work(worker); });
+                    idle_.push_back(worker);
+                }
+                Worker *worker = idle_.back();
+                idle_.pop_back();
+                worker->job = &job;
+                worker->wake.notify_one();
+            }
+        }
+        work();
+        std::unique_lock<std::mutex> lock(mutex_);
+        job.done.wait(lock, [&]() { return job.unfinished == 0; });
+    }
+
+private:
+    struct Job {
+        const std::function<void()> *work;
+        int unfinished;
+        std::condition_variable done;
+    };
+
+    struct Worker {
+        std::thread thread;
+        std::condition_variable wake;
+        Job *job = nullptr;
+    };
+
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<Worker *> idle_;
+    bool stopping_ = false;
+
+    void Work(Worker *worker) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            worker->wake.wait(lock, [&]() { return stopping_ || worker->job != nullptr; });
+            if (stopping_) return;
+            Job *job = worker->job;
+            lock.unlock();
+            (*job->work)();
+            lock.lock();
+            worker->job = nullptr;
+            idle_.push_back(worker);
+            if (--job->unfinished == 0) job->done.notify_one();
+        }
+    }
+};
+
+// runs work on num_threads threads, including the caller's.
+void RunThreads(int num_threads, const std::function<void()> &work) {
+    static WorkerPool pool;
+    pool.Run(num_threads, work);
+}
+
+// how many cubes to split into per thread when counting. uneven cubes are the rule (one side
+// of a branch often closes at once), so threads need several each to finish together. each
+// costs a State copy and replaying its decisions, cheap next to the search within it.
+constexpr int kCubesPerThread = 16;
+
+} // namespace
+
+extern "C"
+size_t DrakeSolveSudoku(const char *input, size_t limit, uint32_t configuration, char *solution,
+                        size_t *num_guesses) {
+    return ThreadSolver().SolveSudoku(input, limit, configuration, solution, num_guesses);
+}
+
+extern "C"
+DrakeStatus DrakeSolveSudokuWithBudget(const char *input, size_t limit, uint32_t configuration,
+                                       const DrakeBudget *budget, DrakeResult *result,
+                                       char *partial_grid) {
+    Solver &solver = ThreadSolver();
+    solver.SetBudget(budget->max_guesses, budget->max_microseconds);
+    result->num_solutions = solver.SolveSudoku(input, limit, configuration, result->solution,
+                                               &result->num_guesses);
+    // the thread's solver also serves unbudgeted calls.
+    solver.SetBudget(DRAKE_NO_GUESS_LIMIT, DRAKE_NO_TIME_LIMIT);
+    if (!solver.budget_exhausted_) return DRAKE_COMPLETE;
+    if (partial_grid != nullptr) solver.PartialGrid(partial_grid);
+    return DRAKE_BUDGET_EXHAUSTED;
+}
+
+// DrakeSolveBatch with interleave puzzles in flight on each thread: each thread claims that
+// many at a time and runs their initial propagations a wave at a time in turn, prefetching each
+// one's next wave while the others run, then searches them one after another. an experiment
+// (README, experiment 4) that measured within noise, so it isn't part of the API; run_tests
+// reaches it through the static library to keep it correct.
+extern "C"
+size_t DrakeSolveBatchInterleaved(bool pencilmark, size_t num_puzzles, const char *puzzles,
+                                  size_t limit, uint32_t configuration, DrakeResult *results,
+                                  int num_threads, int interleave) {
+    size_t stride = pencilmark ? 729 : 81;
+    size_t width = (size_t) std::max(interleave, 1);
+    std::atomic<size_t> next_puzzle{0};
+    std::atomic<size_t> num_solved{0};
+    // each thread claims puzzles width at a time and solves them with its own solver.
+    auto work = [&]() {
+        Solver &solver = ThreadSolver();
+        size_t count = 0;
+        // vanilla puzzles are back to back, so each gets a terminator before the solver looks
+        // at input[81] to tell it from a pencilmark puzzle.
+        std::vector<std::array<char, 82>> vanilla(width, std::array<char, 82>{});
+        std::vector<const char *> inputs(width);
+        std::vector<char *> solutions(width);
+        std::vector<size_t> num_solutions(width), num_guesses(width);
+        for (size_t begin = next_puzzle.fetch_add(width); begin < num_puzzles;
+             begin = next_puzzle.fetch_add(width)) {
+            size_t num = std::min(width, num_puzzles - begin);
+            for (size_t j = 0; j < num; j++) {
+                inputs[j] = puzzles + (begin + j) * stride;
+                if (!pencilmark) {
+                    memcpy(vanilla[j].data(), inputs[j], 81);
+                    inputs[j] = vanilla[j].data();
+                }
+                solutions[j] = results[begin + j].solution;
+            }
+            if (width == 1) {
+                num_solutions[0] = solver.SolveSudoku(inputs[0], limit, configuration,
+                                                      solutions[0], &num_guesses[0]);
+            } else {
+                solver.SolveInterleaved(num, inputs.data(), limit, configuration,
+                                        solutions.data(), num_solutions.data(),
+                                        num_guesses.data());
+            }
+            for (size_t j = 0; j < num; j++) {
+                DrakeResult &result = results[begin + j];
+                result.num_solutions = num_solutions[j];
+                result.num_guesses = num_guesses[j];
+                count += result.num_solutions > 0;
+            }
+        }
+        num_solved += count;
+    };
+    RunThreads(NumThreads(num_threads, (num_puzzles + width - 1) / width), work);
+    return num_solved;
+}
+
+extern "C"
+size_t DrakeSolveBatch(bool pencilmark, size_t num_puzzles, const char *puzzles, size_t limit,
+                       uint32_t configuration, DrakeResult *results, int num_threads) {
+    return DrakeSolveBatchInterleaved(pencilmark, num_puzzles, puzzles, limit, configuration,
+                                      results, num_threads, 1);
+}
+
+extern "C"
+size_t DrakeCountSolutions(const char *input, size_t limit, uint32_t configuration,
+                           size_t *num_guesses, int num_threads) {
+    num_threads = NumThreads(num_threads, SIZE_MAX);
+    if (num_threads == 1) {
+        char solution[81];
+        return DrakeSolveSudoku(input, limit, configuration, solution, num_guesses);
+    }
+    // deep enough for kCubesPerThread cubes per thread if every branch stays open.
+    size_t depth = 0;
+    while ((1 << depth) < num_threads * kCubesPerThread) depth++;
+    // cubes shallower than depth are split in two, deeper ones counted. splitting is work like
+    // any other, so it's spread over the threads too rather than done up front by one.
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<std::vector<LiteralId>> cubes(1);
+    int num_busy = 0;
+    std::atomic<size_t> total_solutions{0};
+    std::atomic<size_t> total_guesses{0};
+    auto work = [&]() {
+        Solver &solver = ThreadSolver();
+        Solver::State root;
+        bool consistent = solver.InitializeRoot(input, &root);
+        size_t guesses = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            // the queue only runs dry for good once no thread is splitting a cube.
+            changed.wait(lock, [&]() { return !cubes.empty() || num_busy == 0; });
+            if (cubes.empty()) break;
+            std::vector<LiteralId> cube = std::move(cubes.front());
+            cubes.pop_front();
+            num_busy++;
+            lock.unlock();
+            size_t found = total_solutions.load();
+            if (!consistent || found >= limit) {
+                // nothing left to do but drain the queue.
+            } else if (cube.size() < depth) {
+                LiteralId literal;
+                switch (solver.ExpandCube(root, cube, &literal)) {
+                    case Solver::kCubeRefuted:
+                        break;
+                    case Solver::kCubeSolved:
+                        total_solutions++;
+                        break;
+                    case Solver::kCubeOpen: {
+                        guesses++;
+                        cube.push_back(literal);
+                        std::vector<LiteralId> other = cube;
+                        other.back() = Solver::Not(literal);
+                        lock.lock();
+                        cubes.push_back(std::move(cube));
+                        cubes.push_back(std::move(other));
+                        lock.unlock();
+                        changed.notify_all();
+                    }
+                }
+            } else {
+                size_t cube_guesses = 0;
+                total_solutions += solver.CountCube(root, cube, limit - found, configuration,
+                                                    &cube_guesses);
+                guesses += cube_guesses;
+            }
+            lock.lock();
+            if (--num_busy == 0 && cubes.empty()) changed.notify_all();
+        }
+        total_guesses += guesses;
+    };
+    RunThreads(num_threads, work);
+    *num_guesses = total_guesses;
+    return std::min<size_t>(total_solutions, limit);
+}
@@ -0,0 +1,187 @@
+#ifndef DRAKE_H
+#define DRAKE_H
+
+#ifdef __cplusplus
+#include <cstddef>
+#include <cstdint>
+#else
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#endif
+
+// the library is built with hidden visibility; these are the only symbols it exports.
+#if defined(__GNUC__)
+#define DRAKE_API __attribute__((visibility("default")))
+#else
+#define DRAKE_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * The outcome of solving one puzzle in a batch.
+ */
+typedef struct DrakeResult {
+    /** The number of solutions found up to the batch's limit. */
+    size_t num_solutions;
+    /** The number of guesses performed during search. */
+    size_t num_guesses;
+    /** The first solution found, as 81 digits, if num_solutions > 0. Not null terminated. */
+    char solution[81];
+} DrakeResult;
+
+/** DrakeBudget values for no bound on guesses or on time. */
+#define DRAKE_NO_GUESS_LIMIT SIZE_MAX
+#define DRAKE_NO_TIME_LIMIT UINT64_MAX
+
+/**
+ * Bounds on the work of one solve (see DrakeSolveSudokuWithBudget). Zero is a real bound: a
+ * search that needs any guess stops before its first.
+ */
+typedef struct DrakeBudget {
+    /** The maximum number of guesses, or DRAKE_NO_GUESS_LIMIT. */
+    size_t max_guesses;
+    /** The maximum time, in microseconds, checked every few guesses, or DRAKE_NO_TIME_LIMIT. */
+    uint64_t max_microseconds;
+} DrakeBudget;
+
+/**
+ * How a budgeted solve ended.
+ */
+typedef enum DrakeStatus {
+    /** The search finished: it found the limit's worth of solutions or all of them. */
+    DRAKE_COMPLETE = 0,
+    /** The budget ran out first. The result holds what was found up to then. */
+    DRAKE_BUDGET_EXHAUSTED = 1
+} DrakeStatus;
+
+/**
+ * Solves a Sudoku or Pencilmark Sudoku puzzle with the lab's SCC solver (the vectorized SoA
+ * build). Each calling thread keeps its own solver, so the clause and implication setup is
+ * paid once per thread rather than once per call, and calls from different threads are safe.
+ * @param input
+ *      An 81 character standard sudoku or 729 character pencilmark sudoku, exactly as for
+ *      tdoku's SolveSudoku (see tdoku.h). The solver decides which it is by checking whether
+ *      input[81] is >= '.' (vs. newline or null).
+ * @param limit
+ *      The maximum number of solutions to find before returning.
+ * @param configuration
+ *      Bit 0 enables SCC inference, bit 1 SCC-driven branching and bit 2 failed-literal probing
+ *      before each guess. Bit 3 first propagates naked and hidden singles on per-cell
+ *      candidates, which settles most easy puzzles without the SCC search and seeds it with the
+ *      eliminations for the rest. 3 is the usual choice, and 11 for mostly easy puzzles.
+ * @param solution
+ *      Pointer to an 81 character array to receive the first solution found, if any.
+ * @param num_guesses
+ *      Out parameter to receive the number of guesses performed during search.
+ * @return
+ *      The number of solutions found up to the given limit.
+ */
+DRAKE_API size_t DrakeSolveSudoku(const char *input,
+                                  size_t limit,
+                                  uint32_t configuration,
+                                  char *solution,
+                                  size_t *num_guesses);
+
+/**
+ * Solves a puzzle as DrakeSolveSudoku does, but gives up once the budget runs out, for callers
+ * that can't wait on a pathological puzzle. An unbudgeted solve and one that completes within
+ * its budget find the same solutions with the same guesses.
+ * @param input
+ *      As for DrakeSolveSudoku.
+ * @param limit
+ *      As for DrakeSolveSudoku.
+ * @param configuration
+ *      As for DrakeSolveSudoku.
+ * @param budget
+ *      The bounds on the search. The time is checked every 8 guesses, so the search can
+ *      overrun it by the time those take (around 100 microseconds on hard 9x9 searches). It
+ *      doesn't cover a thread's first call setting up its solver (under a millisecond).
+ * @param result
+ *      Receives the number of solutions and guesses up to the end of the search, and the first
+ *      solution found, if any, whether or not it completed.
+ * @param partial_grid
+ *      Null, or an 81 character array that, if the budget runs out, receives the grid as
+ *      propagated before the first guess: a digit for each cell that was decided and '.' for
+ *      the rest. Not null terminated. Left alone if the search completes.
+ * @return
+ *      DRAKE_COMPLETE, or DRAKE_BUDGET_EXHAUSTED if the budget ran out first.
+ */
+DRAKE_API DrakeStatus DrakeSolveSudokuWithBudget(const char *input,
+                                                 size_t limit,
+                                                 uint32_t configuration,
+                                                 const DrakeBudget *budget,
+                                                 DrakeResult *result,
+                                                 char *partial_grid);
+
+/**
+ * Solves many puzzles as DrakeSolveSudoku does, optionally in parallel. Threads claim puzzles
+ * one at a time, so results are in puzzle order however the work was split.
+ * @param pencilmark
+ *      A boolean indicating whether the puzzles are pencilmark sudokus (vs. vanilla ones).
+ * @param num_puzzles
+ *      The number of puzzles to solve.
+ * @param puzzles
+ *      num_puzzles puzzles of 81 or 729 characters each (for vanilla vs. pencilmark), stored
+ *      back to back with no separators.
+ * @param limit
+ *      As for DrakeSolveSudoku, per puzzle.
+ * @param configuration
+ *      As for DrakeSolveSudoku.
+ * @param results
+ *      An array of num_puzzles results to receive each puzzle's outcome.
+ * @param num_threads
+ *      The number of threads to use, including the caller's. Zero or less means one per core.
+ *      The others come from a pool the library keeps between calls, so like the caller's they
+ *      set up their solvers once, not once per call.
+ * @return
+ *      The number of puzzles with at least one solution.
+ */
+DRAKE_API size_t DrakeSolveBatch(bool pencilmark,
+                                 size_t num_puzzles,
+                                 const char *puzzles,
+                                 size_t limit,
+                                 uint32_t configuration,
+                                 DrakeResult *results,
+                                 int num_threads);
+
+/**
+ * Counts the solutions of a puzzle on several threads, for under-constrained puzzles and
+ * partial grids with many solutions. The search space is split into disjoint cubes, each an
+ * assignment of the few literals the SCC heuristic would branch on first. Threads take cubes
+ * from a shared queue, splitting the shallow ones in two and counting the solutions in the rest
+ * with their own solvers, and the counts are summed. The result is the same as
+ * DrakeSolveSudoku's.
+ * @param input
+ *      As for DrakeSolveSudoku.
+ * @param limit
+ *      The maximum number of solutions to count. Threads stop claiming cubes once it's reached,
+ *      but each first finishes the cube it's counting (up to what was left of the limit when it
+ *      began), so with a limit far below the number of solutions some work is wasted.
+ * @param configuration
+ *      As for DrakeSolveSudoku. It applies to the search within each cube; the split itself
+ *      always uses SCC inference and branching.
+ * @param num_guesses
+ *      Out parameter to receive the number of guesses performed by all threads together,
+ *      including the branches taken while splitting.
+ * @param num_threads
+ *      The number of threads to use, including the caller's. Zero or less means one per core.
+ *      With one thread there's no split and this is just DrakeSolveSudoku. The others come
+ *      from the same pool as DrakeSolveBatch's.
+ * @return
+ *      The number of solutions found up to the given limit.
+ */
+DRAKE_API size_t DrakeCountSolutions(const char *input,
+                                     size_t limit,
+                                     uint32_t configuration,
+                                     size_t *num_guesses,
+                                     int num_threads);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //DRAKE_H
@@ -0,0 +1,279 @@
+// Generates and benchmarks puzzles on larger boards for the templated triad SCC solver.
+//
+// 9x9 search trees are small enough that the parallel and SCC experiments mostly measure
+// overhead. 16x16 and 25x25 boards (boxes of 4x4 and 5x5 cells) give searches that are
+// expensive enough to be worth splitting up. Puzzles use one symbol per cell, '1'..'9' then
+// 'A'..'P', with '.' for empty cells (see SolverDpllTriadScc::InitializePuzzle), one per line.
+//
+//   run_large_grids -b 4 -g 100 -z 1 > puzzles16    // 100 minimal 16x16 puzzles
+//   run_large_grids puzzles16                        // solve them all and report
+//
+// Generated puzzles have a unique solution. Clues are removed in random order for as long as
+// the solution stays unique, or until -k clues remain.
+
+#include "triad_scc_core.hpp"
+#include "adjacency.hpp"
+#include "../third_party/tdoku/src/klib/ketopt.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Options {
+    // box dimension of the board to generate.
+    int box_dim = 4;
+    // solver configuration: bit 0 SCC inference, bit 1 SCC heuristic, bit 2 probing.
+    uint32_t configuration = 3;
+    // number of puzzles to generate, or 0 to benchmark the puzzle file instead.
+    int generate = 0;
+    // stop removing clues when this many remain.
+    int min_clues = 0;
+    // solution limit when benchmarking.
+    size_t limit = 2;
+    uint64_t seed = 0;
+};
+
+template<int box_dim>
+class LargeGrids {
+    using Geometry = BoardGeometry<box_dim>;
+    using Solver = SolverDpllTriadScc<AdjCSR<Geometry::kNumLiterals>, ScalarKernels, Geometry>;
+    static constexpr int kSide = Geometry::kNumValues;
+    static constexpr int kNumCells = Geometry::kNumCells;
+
+    const Options options_;
+    std::unique_ptr<Solver> solver_{new Solver()};
+    std::mt19937_64 rng_;
+
+public:
+    explicit LargeGrids(const Options &options) : options_(options), rng_(options.seed) {}
+
+    void Generate() {
+        for (int i = 0; i < options_.generate; i++) {
+            std::string puzzle = RandomGrid();
+            std::vector<int> cells(kNumCells);
+            std::iota(cells.begin(), cells.end(), 0);
+            std::shuffle(cells.begin(), cells.end(), rng_);
+            int num_clues = kNumCells;
+            for (int cell : cells) {
+                if (num_clues <= options_.min_clues) break;
+                char clue = puzzle[cell];
+                puzzle[cell] = '.';
+                if (Solve(puzzle, 2) == 1) {
+                    num_clues--;
+                } else {
+                    puzzle[cell] = clue;
+                }
+            }
+            printf("%s\n", puzzle.c_str());
+            fflush(stdout);
+        }
+    }
+
+    void Benchmark(const std::vector<std::string> &puzzles) {
+        using std::chrono::steady_clock;
+        size_t total_guesses = 0, num_no_guess = 0, num_solved = 0, num_invalid = 0;
+        double total_seconds = 0;
+        for (const std::string &puzzle : puzzles) {
+            char solution[kNumCells + 1]{};
+            size_t guesses = 0;
+            auto start = steady_clock::now();
+            size_t count = solver_->SolveSudoku(puzzle.c_str(), options_.limit,
+                                                options_.configuration, solution, &guesses);
+            total_seconds += std::chrono::duration<double>(steady_clock::now() - start).count();
+            total_guesses += guesses;
+            num_no_guess += guesses == 0;
+            if (count > 0) {
+                num_solved++;
+                num_invalid += !ValidSolution(puzzle, solution);
+            }
+        }
+        double n = (double) puzzles.size();
+        printf("%dx%d board, %zu puzzles, configuration %u, limit %zu\n", kSide, kSide,
+               puzzles.size(), options_.configuration, options_.limit);
+        printf("  %.1f puzzles/sec, %.1f usec/puzzle, %.1f%% no guess, %.2f guesses/puzzle\n",
+               n / total_seconds, 1e6 * total_seconds / n, 100.0 * num_no_guess / n,
+               total_guesses / n);
+        printf("  %zu with solutions, %zu invalid solutions\n", num_solved, num_invalid);
+    }
+
+private:
+    size_t Solve(const std::string &puzzle, size_t limit) {
+        char solution[kNumCells + 1]{};
+        size_t guesses;
+        return solver_->SolveSudoku(puzzle.c_str(), limit, options_.configuration, solution,
+                                    &guesses);
+    }
+
+    // a valid grid from a pattern, relabeled and with rows, columns, bands and stacks
+    // shuffled, then maybe transposed.
+    std::string RandomGrid() {
+        std::vector<int> symbols(kSide), rows(kSide), cols(kSide);
+        std::iota(symbols.begin(), symbols.end(), 0);
+        std::shuffle(symbols.begin(), symbols.end(), rng_);
+        ShuffleBands(&rows);
+        ShuffleBands(&cols);
+        bool transpose = rng_() & 1u;
+        std::string grid(kNumCells, '.');
+        for (int r = 0; r < kSide; r++) {
+            for (int c = 0; c < kSide; c++) {
+                int row = rows[r], col = cols[c];
+                int value = ((row % box_dim) * box_dim + row / box_dim + col) % kSide;
+                grid[transpose ? c * kSide + r : r * kSide + c] = kValueSymbols[symbols[value]];
+            }
+        }
+        return grid;
+    }
+
+    // a permutation of rows (or columns) that keeps each band of box_dim together.
+    void ShuffleBands(std::vector<int> *lines) {
+        std::vector<int> bands(box_dim);
+        std::iota(bands.begin(), bands.end(), 0);
+        std::shuffle(bands.begin(), bands.end(), rng_);
+        for (int band = 0; band < box_dim; band++) {
+            std::vector<int> within(box_dim);
+            std::iota(within.begin(), within.end(), 0);
+            std::shuffle(within.begin(), within.end(), rng_);
+            for (int i = 0; i < box_dim; i++) {
+                (*lines)[band * box_dim + i] = bands[band] * box_dim + within[i];
+            }
+        }
+    }
+
+    // whether the solution is a full grid that agrees with the puzzle's clues or candidates.
+    static bool ValidSolution(const std::string &puzzle, const char *solution) {
+        bool pencilmark = puzzle.size() >= (size_t) kNumCells * kSide;
+        std::vector<uint32_t> row_seen(kSide), col_seen(kSide), box_seen(kSide);
+        for (int cell = 0; cell < kNumCells; cell++) {
+            int value = SymbolValue(solution[cell]);
+            if (value < 0 || value >= kSide) return false;
+            if (pencilmark) {
+                if (puzzle[cell * kSide + value] == '.') return false;
+            } else if (puzzle[cell] != '.' && SymbolValue(puzzle[cell]) != value) {
+                return false;
+            }
+            int row = cell / kSide, col = cell % kSide;
+            int box = row / box_dim * box_dim + col / box_dim;
+            uint32_t bit = 1u << (unsigned) value;
+            if ((row_seen[row] | col_seen[col] | box_seen[box]) & bit) return false;
+            row_seen[row] |= bit;
+            col_seen[col] |= bit;
+            box_seen[box] |= bit;
+        }
+        return true;
+    }
+};
+
+// the box dimension of a board with this many cells (or pencilmark characters), or 0.
+int BoxDimForLength(size_t length) {
+    for (int box_dim = 3; box_dim <= 5; box_dim++) {
+        size_t side = box_dim * box_dim;
+        if (length == side * side || length == side * side * side) return box_dim;
+    }
+    return 0;
+}
+
+template<int box_dim>
+void Run(const Options &options, const std::vector<std::string> &puzzles) {
+    LargeGrids<box_dim> grids(options);
+    if (options.generate > 0) {
+        grids.Generate();
+    } else {
+        grids.Benchmark(puzzles);
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options options{};
+
+    ketopt_t opt = KETOPT_INIT;
+    char c;
+    while ((c = (char) ketopt(&opt, argc, argv, 1, "b:c:g:hk:l:z:", nullptr)) != -1) {
+        switch (c) {
+            case 'b': {
+                options.box_dim = stoi(string(opt.arg));
+                break;
+            }
+            case 'c': {
+                options.configuration = (uint32_t) stoul(string(opt.arg));
+                break;
+            }
+            case 'g': {
+                options.generate = stoi(string(opt.arg));
+                break;
+            }
+            case 'k': {
+                options.min_clues = stoi(string(opt.arg));
+                break;
+            }
+            case 'l': {
+                options.limit = stoul(string(opt.arg));
+                break;
+            }
+            case 'z': {
+                options.seed = stoull(string(opt.arg));
+                break;
+            }
+            case 'h':
+            default: {
+                cout << "usage: run_large_grids <options> [puzzle file]" << endl;
+                cout << "options:" << endl;
+                cout << "  -b <box_dim>        // board to generate: 3 (9x9), 4 (16x16) or 5 (25x25) [default 4]" << endl;
+                cout << "  -c <configuration>  // solver configuration bits [default 3]" << endl;
+                cout << "  -g <count>          // generate puzzles to stdout instead of benchmarking" << endl;
+                cout << "  -h                  // display this help message" << endl;
+                cout << "  -k <clues>          // stop removing clues when this many remain [default 0]" << endl;
+                cout << "  -l <limit>          // solution limit when benchmarking [default 2]" << endl;
+                cout << "  -z <seed>           // random seed for generation [default 0]" << endl;
+                exit(0);
+            }
+        }
+    }
+
+    std::vector<std::string> puzzles;
+    if (options.generate == 0) {
+        if (opt.ind >= argc) {
+            cout << "no puzzle file given" << endl;
+            exit(1);
+        }
+        std::ifstream file(argv[opt.ind]);
+        if (file.fail()) {
+            cout << "Error opening " << argv[opt.ind] << endl;
+            exit(1);
+        }
+        std::string line;
+        while (getline(file, line)) {
+            if (line.empty() || line[0] == '#') continue;
+            line = line.substr(0, line.find_first_of(" \t:\r"));
+            if (!puzzles.empty() && line.size() != puzzles[0].size()) {
+                cout << "puzzles of different sizes in " << argv[opt.ind] << endl;
+                exit(1);
+            }
+            puzzles.push_back(line);
+        }
+        if (puzzles.empty()) {
+            cout << "no puzzles in " << argv[opt.ind] << endl;
+            exit(1);
+        }
+        options.box_dim = BoxDimForLength(puzzles[0].size());
+    }
+
+    switch (options.box_dim) {
+        case 3: Run<3>(options, puzzles); break;
+        case 4: Run<4>(options, puzzles); break;
+        case 5: Run<5>(options, puzzles); break;
+        default: {
+            cout << "unsupported board" << endl;
+            exit(1);
+        }
+    }
+}
@@ -0,0 +1,487 @@
+// Kernel-level microbenchmarks for the lab solver building blocks.
+//
+// End-to-end puzzles/sec doesn't tell us which piece of the solver regressed, so this target
+// times the individual kernels (InitializePuzzle, Assert, FindStronglyConnectedComponents,
+// State copy, AddBinaryImplicationsAmongNonEliminated, AdjCSR vs AdjVector iteration, and the
+// scalar vs SIMD scans of triad_scc_simd.hpp) on frozen snapshots captured from real puzzles. The puzzles are embedded below so there's no
+// dependency on the data directory.
+//
+// Output is CSV, one row per kernel and snapshot, meant to be diffed across commits:
+//   compiler,compiler_version,flags,kernel,snapshot,ops,ns_per_op,cycles_per_op,instructions_per_op
+// Each kernel is measured over several repetitions and we report the fastest one. Cycles and
+// instructions come from perf_event_open and are reported as N/A where that's unavailable
+// (non-Linux hosts, containers, perf_event_paranoid > 2).
+
+#include "triad_scc_core.hpp"
+#include "triad_scc_simd.hpp"
+#include "adjacency.hpp"
+#include "../third_party/tdoku/src/build_info.h"
+#include "../third_party/tdoku/src/klib/ketopt.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+using Solver = SolverDpllTriadScc<AdjCSR<kNumLiterals>>;
+
+template<class T>
+inline void DoNotOptimize(const T &value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// user-space cycle and instruction counters for the calling thread, if the kernel lets us.
+class PerfCounters {
+    int cycles_fd_ = -1;
+    int instructions_fd_ = -1;
+
+#ifdef __linux__
+    static int Open(uint64_t config, int group_fd) {
+        perf_event_attr attr{};
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = config;
+        attr.disabled = group_fd == -1 ? 1 : 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        return (int) syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0);
+    }
+#endif
+
+public:
+    PerfCounters() {
+#ifdef __linux__
+        cycles_fd_ = Open(PERF_COUNT_HW_CPU_CYCLES, -1);
+        if (cycles_fd_ >= 0) {
+            instructions_fd_ = Open(PERF_COUNT_HW_INSTRUCTIONS, cycles_fd_);
+            if (instructions_fd_ < 0) {
+                close(cycles_fd_);
+                cycles_fd_ = -1;
+            }
+        }
+#endif
+    }
+
+    ~PerfCounters() {
+#ifdef __linux__
+        if (instructions_fd_ >= 0) close(instructions_fd_);
+        if (cycles_fd_ >= 0) close(cycles_fd_);
+#endif
+    }
+
+    bool Available() const {
+        return cycles_fd_ >= 0;
+    }
+
+    void Start() {
+#ifdef __linux__
+        if (!Available()) return;
+        ioctl(cycles_fd_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(cycles_fd_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+    }
+
+    void Stop(uint64_t *cycles, uint64_t *instructions) {
+        *cycles = *instructions = 0;
+#ifdef __linux__
+        if (!Available()) return;
+        ioctl(cycles_fd_, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        uint64_t value = 0;
+        if (read(cycles_fd_, &value, sizeof(value)) == sizeof(value)) *cycles = value;
+        if (read(instructions_fd_, &value, sizeof(value)) == sizeof(value)) *instructions = value;
+#endif
+    }
+};
+
+struct Options {
+    // number of repetitions per kernel. we report the fastest.
+    int repetitions = 7;
+    // minimum timed duration of each repetition.
+    int min_ms_per_repetition = 20;
+    // only run kernels whose name contains this substring.
+    std::string filter;
+};
+
+// a solver state captured from a puzzle. the "root" snapshot is the state after clue
+// propagation and the SCC fixpoint, and "mid" is the state one guess deeper (only for puzzles
+// that need a guess). branch literals are the ones the SCC heuristic would choose.
+//
+// states don't own their implication lists; they hold stack pointers into the solver's
+// literals_to_implications_. so each snapshot gets a solver of its own, since propagating
+// from one snapshot would overwrite implications another snapshot depends on.
+struct Snapshot {
+    std::string name;
+    std::unique_ptr<Solver> solver;
+    State state;
+    LiteralId branch_literal = kNoLiteral;
+};
+
+struct Puzzle {
+    const char *name;
+    const char *input;
+};
+
+// from test/test_puzzles: an easy puzzle, a 17-clue puzzle, and a hard 22-clue puzzle.
+const Puzzle kPuzzles[] = {
+        {"easy", ".5..83.17...1..4..3.4..56.8....3...9.9.8245....6....7...9....5...729..861.36.72.4"},
+        {"17clue", "........8..3...4...9..2..6.....79.......612...6.5.2.7...8...5...1.....2.4.5.....3"},
+        {"hard", "..4..3....7..8....2.81....6..3....9..8..2....1..7....3......45....8..9....9..5..8"},
+};
+
+class MicroBenchmark {
+    const Options options_;
+    PerfCounters perf_{};
+    std::vector<Snapshot> snapshots_{};
+    // solver for one-clue assertions on the empty board, and those clues, one per puzzle.
+    Solver empty_board_solver_{};
+    std::vector<std::pair<std::string, LiteralId>> first_clues_{};
+
+    // scratch copies so we can time destructive kernels without timing the copy.
+    static constexpr int kBatch = 64;
+    std::vector<State> batch_ = std::vector<State>(kBatch);
+
+public:
+    explicit MicroBenchmark(const Options &options) : options_(options) {
+        for (const Puzzle &puzzle : kPuzzles) {
+            for (int i = 0; i < 81; i++) {
+                if (puzzle.input[i] != '.') {
+                    first_clues_.emplace_back(puzzle.name,
+                                              Solver::CellLiteral(i, puzzle.input[i] - '1'));
+                    break;
+                }
+            }
+            Capture(puzzle, false);
+            Capture(puzzle, true);
+        }
+    }
+
+    static void OutputHeader() {
+        printf("compiler,compiler_version,flags,kernel,snapshot,ops,"
+               "ns_per_op,cycles_per_op,instructions_per_op\n");
+    }
+
+    void Run() {
+        OutputHeader();
+
+        Solver &empty = empty_board_solver_;
+
+        // State copy as done on every guess in BranchOnLiteral (assigned over the branch
+        // state reused at that depth).
+        for (const Snapshot &snapshot : snapshots_) {
+            State copy = snapshot.state;
+            Measure("state_copy", snapshot.name, [&]() {
+                for (int i = 0; i < kBatch; i++) {
+                    copy = snapshot.state;
+                    DoNotOptimize(copy.num_asserted);
+                }
+                return kBatch;
+            });
+        }
+
+        // clue propagation for each whole puzzle, given as clues and as pencilmarks (one
+        // candidate left in clue cells, all nine elsewhere).
+        for (const Puzzle &puzzle : kPuzzles) {
+            std::string pencilmarks = Pencilmarks(puzzle.input);
+            MeasureOnCopies("initialize_puzzle", std::string(puzzle.name) + "/vanilla",
+                            empty.initial_state_, [&](State *state) {
+                DoNotOptimize(empty.InitializePuzzle(puzzle.input, false, state));
+                return 1;
+            });
+            MeasureOnCopies("initialize_puzzle", std::string(puzzle.name) + "/pencilmark",
+                            empty.initial_state_, [&](State *state) {
+                DoNotOptimize(empty.InitializePuzzle(pencilmarks.c_str(), true, state));
+                return 1;
+            });
+        }
+
+        // Assert of a first clue on the empty board, and of the branch literal (and its
+        // negation) on captured states. each op is one top-level Assert with its full
+        // recursive propagation.
+        for (const auto &clue : first_clues_) {
+            MeasureOnCopies("assert_clue", clue.first, empty.initial_state_, [&](State *state) {
+                DoNotOptimize(empty.Assert(clue.second, state));
+                return 1;
+            });
+        }
+        for (const Snapshot &snapshot : snapshots_) {
+            if (snapshot.branch_literal == kNoLiteral) continue;
+            Solver &solver = *snapshot.solver;
+            MeasureOnCopies("assert_branch", snapshot.name, snapshot.state, [&](State *state) {
+                DoNotOptimize(solver.Assert(snapshot.branch_literal, state));
+                return 1;
+            });
+            MeasureOnCopies("assert_branch_negation", snapshot.name, snapshot.state,
+                            [&](State *state) {
+                DoNotOptimize(solver.Assert(Solver::Not(snapshot.branch_literal), state));
+                return 1;
+            });
+        }
+
+        // one full pass of SCC discovery, including any inferences it makes.
+        for (const Snapshot &snapshot : snapshots_) {
+            Solver &solver = *snapshot.solver;
+            MeasureOnCopies("find_scc", snapshot.name, snapshot.state, [&](State *state) {
+                DoNotOptimize(solver.FindStronglyConnectedComponents<true>(state));
+                return 1;
+            });
+        }
+
+        // the scans the core takes from its Kernels policy, scalar and vectorized: the roots
+        // of an SCC pass (each op visits every undecided positive literal) and the choice of a
+        // cell clause to branch on.
+        for (const Snapshot &snapshot : snapshots_) {
+            MeasureUndecidedPositive<ScalarKernels>("undecided_positive_scalar", snapshot);
+            MeasureUndecidedPositive<SimdKernels>("undecided_positive_simd", snapshot);
+            MeasureMinFreeCell<ScalarKernels>("min_free_cell_scalar", snapshot);
+            MeasureMinFreeCell<SimdKernels>("min_free_cell_simd", snapshot);
+        }
+
+        // re-derive the binary implications of every clause that has already reached its
+        // trigger point in the snapshot. each op is one clause.
+        for (const Snapshot &snapshot : snapshots_) {
+            Solver &solver = *snapshot.solver;
+            std::vector<ClauseId> triggered;
+            for (ClauseId clause_id = 0; clause_id < solver.clauses_to_literals_.size(); clause_id++) {
+                if (snapshot.state.clause_free_literals[clause_id] == 0) triggered.push_back(clause_id);
+            }
+            if (triggered.empty()) continue;
+            MeasureOnCopies("add_binary_implications", snapshot.name, snapshot.state,
+                            [&](State *state) {
+                for (ClauseId clause_id : triggered) {
+                    solver.AddBinaryImplicationsAmongNonEliminated(clause_id, state);
+                }
+                return (int) triggered.size();
+            });
+        }
+
+        // adjacency iteration over the literals still undecided in each snapshot, which is
+        // what Assert and AddBinaryImplicationsAmongNonEliminated walk during search.
+        AdjVector<kNumLiterals> adj_vector;
+        adj_vector.build(empty.clauses_to_literals_, empty.literals_to_clauses_);
+        const AdjCSR<kNumLiterals> &adj_csr = empty.adj_;
+        for (const Snapshot &snapshot : snapshots_) {
+            std::vector<LiteralId> undecided;
+            for (LiteralId literal = 0; literal < kNumLiterals; literal++) {
+                if (Solver::ValidLiteral(literal) && !snapshot.state.asserted.pos_or_neg(literal)) {
+                    undecided.push_back(literal);
+                }
+            }
+            if (undecided.empty()) continue;
+            MeasureAdjacency("adj_csr", snapshot.name, adj_csr, undecided);
+            MeasureAdjacency("adj_vector", snapshot.name, adj_vector, undecided);
+        }
+    }
+
+private:
+    static std::string Pencilmarks(const char *input) {
+        std::string pencilmarks;
+        for (int i = 0; i < 81; i++) {
+            for (char digit = '1'; digit <= '9'; digit++) {
+                pencilmarks += (input[i] == '.' || input[i] == digit) ? digit : '.';
+            }
+        }
+        return pencilmarks;
+    }
+
+    void Capture(const Puzzle &puzzle, bool one_guess_deep) {
+        auto solver = std::unique_ptr<Solver>(new Solver());
+        State state = solver->initial_state_;
+        if (!solver->InitializePuzzle(puzzle.input, false, &state) || !Fixpoint(solver.get(), &state)) {
+            fprintf(stderr, "could not capture snapshot for %s\n", puzzle.name);
+            exit(1);
+        }
+        LiteralId branch = state.num_asserted < kAllAsserted ? solver->best_component_literal : kNoLiteral;
+        if (one_guess_deep) {
+            if (branch == kNoLiteral) return;
+            // follow the first branch, or its negation if the first branch fails as the search
+            // would, to a state one guess deep.
+            State root = state;
+            if (!solver->Assert(branch, &state) || !Fixpoint(solver.get(), &state)) {
+                state = root;
+                if (!solver->Assert(Solver::Not(branch), &state) || !Fixpoint(solver.get(), &state)) {
+                    return;
+                }
+            }
+            branch = state.num_asserted < kAllAsserted ? solver->best_component_literal : kNoLiteral;
+        }
+        std::string name = std::string(puzzle.name) + (one_guess_deep ? "/mid" : "/root");
+        snapshots_.push_back(Snapshot{name, std::move(solver), state, branch});
+    }
+
+    // the SCC fixpoint loop from CountSolutionsConsistentWithPartialAssignment.
+    static bool Fixpoint(Solver *solver, State *state) {
+        while (state->num_asserted < kAllAsserted) {
+            auto prev_asserted = state->num_asserted;
+            if (!solver->FindStronglyConnectedComponents<true>(state)) return false;
+            if (prev_asserted == state->num_asserted) break;
+        }
+        return true;
+    }
+
+    bool Selected(const char *kernel) const {
+        return options_.filter.empty() || std::string(kernel).find(options_.filter) != std::string::npos;
+    }
+
+    // times `body`, which performs some number of ops and returns that number. `prepare` runs
+    // untimed before each call to `body`.
+    void Measure(const char *kernel, const std::string &snapshot,
+                 const std::function<int()> &body,
+                 const std::function<void()> &prepare = []() {}) {
+        if (!Selected(kernel)) return;
+        using std::chrono::steady_clock;
+        double best_ns = 0, best_cycles = 0, best_instructions = 0;
+        uint64_t best_ops = 0;
+        prepare();
+        body(); // warm caches and branch predictors
+        for (int rep = 0; rep < options_.repetitions; rep++) {
+            uint64_t total_ns = 0, total_cycles = 0, total_instructions = 0, total_ops = 0;
+            while (total_ns < (uint64_t) options_.min_ms_per_repetition * 1000000) {
+                prepare();
+                uint64_t cycles, instructions;
+                perf_.Start();
+                auto start = steady_clock::now();
+                int ops = body();
+                auto end = steady_clock::now();
+                perf_.Stop(&cycles, &instructions);
+                total_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+                total_cycles += cycles;
+                total_instructions += instructions;
+                total_ops += ops;
+            }
+            double ns = (double) total_ns / total_ops;
+            if (rep == 0 || ns < best_ns) {
+                best_ns = ns;
+                best_cycles = (double) total_cycles / total_ops;
+                best_instructions = (double) total_instructions / total_ops;
+                best_ops = total_ops;
+            }
+        }
+        if (perf_.Available()) {
+            printf("%s,%s,%s,%s,%s,%lu,%f,%f,%f\n", CXX_COMPILER_ID, CXX_COMPILER_VERSION, CXX_FLAGS,
+                   kernel, snapshot.c_str(), (unsigned long) best_ops,
+                   best_ns, best_cycles, best_instructions);
+        } else {
+            printf("%s,%s,%s,%s,%s,%lu,%f,N/A,N/A\n", CXX_COMPILER_ID, CXX_COMPILER_VERSION, CXX_FLAGS,
+                   kernel, snapshot.c_str(), (unsigned long) best_ops, best_ns);
+        }
+        fflush(stdout);
+    }
+
+    // times a kernel that modifies the state it's given, on fresh copies of `source`.
+    void MeasureOnCopies(const char *kernel, const std::string &snapshot, const State &source,
+                         const std::function<int(State *)> &op) {
+        Measure(kernel, snapshot, [&]() {
+            int ops = 0;
+            for (State &state : batch_) ops += op(&state);
+            return ops;
+        }, [&]() {
+            for (State &state : batch_) state = source;
+        });
+    }
+
+    template<class Kernels>
+    void MeasureUndecidedPositive(const char *kernel, const Snapshot &snapshot) {
+        const State &state = snapshot.state;
+        Measure(kernel, snapshot.name, [&]() {
+            uint32_t num_roots = 0;
+            for (int i = 0; i < kBatch; i++) {
+                Kernels::ForEachUndecidedPositive(state.asserted, [&](LiteralId literal) {
+                    num_roots += Solver::ValidLiteral(literal) && !state.asserted.pos_or_neg(literal);
+                    return true;
+                });
+            }
+            DoNotOptimize(num_roots);
+            return kBatch;
+        });
+    }
+
+    template<class Kernels>
+    void MeasureMinFreeCell(const char *kernel, const Snapshot &snapshot) {
+        const uint16_t *cell_free_literals = snapshot.state.clause_free_literals.data();
+        Measure(kernel, snapshot.name, [&]() {
+            int sum = 0;
+            for (int i = 0; i < kBatch; i++) {
+                sum += Kernels::template MinFreeCell<kNumCells>(cell_free_literals);
+                DoNotOptimize(cell_free_literals);
+            }
+            DoNotOptimize(sum);
+            return kBatch;
+        });
+    }
+
+    template<class Adj>
+    void MeasureAdjacency(const char *prefix, const std::string &snapshot, const Adj &adj,
+                          const std::vector<LiteralId> &literals) {
+        std::string clauses_kernel = std::string(prefix) + "_clauses_of_literal";
+        Measure(clauses_kernel.c_str(), snapshot, [&]() {
+            uint32_t sum = 0;
+            for (LiteralId literal : literals) {
+                adj.for_each_clause_of_not_literal(literal, [&](ClauseId clause_id) { sum += clause_id; });
+            }
+            DoNotOptimize(sum);
+            return (int) literals.size();
+        });
+        std::string literals_kernel = std::string(prefix) + "_literals_of_clauses";
+        Measure(literals_kernel.c_str(), snapshot, [&]() {
+            uint32_t sum = 0;
+            for (LiteralId literal : literals) {
+                adj.for_each_clause_of_not_literal(literal, [&](ClauseId clause_id) {
+                    adj.for_each_literal_in_clause(clause_id, [&](LiteralId other) { sum += other; });
+                });
+            }
+            DoNotOptimize(sum);
+            return (int) literals.size();
+        });
+    }
+};
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options options{};
+
+    ketopt_t opt = KETOPT_INIT;
+    char c;
+    while ((c = (char) ketopt(&opt, argc, argv, 1, "hk:m:r:", nullptr)) != -1) {
+        switch (c) {
+            case 'k': {
+                options.filter = opt.arg;
+                break;
+            }
+            case 'm': {
+                options.min_ms_per_repetition = stoi(string(opt.arg));
+                break;
+            }
+            case 'r': {
+                options.repetitions = stoi(string(opt.arg));
+                break;
+            }
+            case 'h':
+            default: {
+                cout << "usage: run_microbench <options>" << endl;
+                cout << "options:" << endl;
+                cout << "  -h                  // display this help message" << endl;
+                cout << "  -k <substring>      // only run kernels whose name contains substring" << endl;
+                cout << "  -m <millis>         // minimum timed millis per repetition [default 20]" << endl;
+                cout << "  -r <reps>           // repetitions per kernel, fastest is reported [default 7]" << endl;
+                exit(0);
+            }
+        }
+    }
+
+    MicroBenchmark benchmark(options);
+    benchmark.Run();
+}
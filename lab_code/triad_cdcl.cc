@@ -0,0 +1,589 @@
+// Conflict-driven clause learning over the triad encoding used by the SCC solvers (see
+// SetupConstraints in triad_scc_core.hpp). Plain DPLL rediscovers the same conflicts in
+// subtree after subtree, which hurts on zero-solution inputs, puzzles with many solutions, and
+// heavily constrained pencilmark grids. This solver learns a clause from each conflict instead:
+//  - every exactly-n constraint of the encoding is kept as two cardinality constraints ("at
+//    least n of these", "at least size - n of their negations") and propagated by counting
+//    falsified literals. reasons are produced lazily when conflict analysis asks for them.
+//  - conflicts are analyzed to the first unique implication point, and we backjump to the
+//    second highest level in the learned clause.
+//  - learned clauses use two watched literals. their number is capped, and the less active
+//    half is deleted whenever the cap is reached.
+//  - branching picks the unassigned variable with the highest decayed conflict activity, with
+//    phase saving and Luby restarts.
+// To count past the first solution we add a clause blocking that solution's decisions and
+// carry on. Those clauses are never deleted, so no solution is counted twice.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+typedef uint32_t Lit; // 2 * variable, plus 1 if negated
+typedef uint32_t Var;
+typedef uint32_t ReasonRef; // a constraint index, or kClauseRef | a learned clause index
+
+constexpr int kNumElems = 16; // 9 cells, 6 triads, and one unused slot, as in the SCC solvers
+constexpr int kNumVars = 9 * kNumElems * 9;
+constexpr int kNumUsedVars = 9 * 15 * 9;
+constexpr ReasonRef kNoReason = UINT32_MAX;
+constexpr ReasonRef kClauseRef = 1u << 31u;
+constexpr Lit kNoLit = UINT32_MAX;
+
+// learned clauses kept between reductions, growing by kLearnedGrowth per reduction up to
+// kMaxLearned, and the number of conflicts per unit of the Luby restart sequence.
+constexpr size_t kInitialMaxLearned = 512;
+constexpr double kLearnedGrowth = 1.1;
+constexpr size_t kMaxLearned = 8192;
+constexpr int kRestartUnit = 64;
+
+inline Var VarOf(Lit literal) { return literal >> 1u; }
+inline Lit Not(Lit literal) { return literal ^ 1u; }
+
+inline Lit Literal(int box, int elem, int value) {
+    return 2 * ((box * kNumElems + elem) * 9 + value);
+}
+
+inline bool IsCell(int elem) { return elem / 4 < 3 && elem % 4 < 3; }
+
+// at least (lits.size() - max_false) of lits must hold.
+struct Cardinality {
+    vector<Lit> lits;
+    int max_false;
+};
+
+struct Clause {
+    vector<Lit> lits;
+    double activity = 0.0;
+    bool permanent = false;
+    bool deleted = false;
+};
+
+// 1, 2, 1, 1, 2, 4, 1, 1, 2, 1, 1, 2, 4, 8, ...
+int Luby(int i) {
+    int size = 1, seq = 0;
+    while (size < i + 1) {
+        seq++;
+        size = 2 * size + 1;
+    }
+    while (size - 1 != i) {
+        size = (size - 1) >> 1u;
+        seq--;
+        i = i % size;
+    }
+    return 1 << seq;
+}
+
+class SolverTriadCdcl {
+public:
+    SolverTriadCdcl() {
+        SetupConstraints();
+        heap_index_.assign(kNumVars, -1);
+    }
+
+    size_t SolveSudoku(const char *input, size_t limit, char *solution, size_t *num_guesses) {
+        Reset();
+        limit_ = limit;
+        num_guesses_ = 0;
+        num_solutions_ = 0;
+        bool pencilmark = input[81] >= '.';
+        if (InitializePuzzle(input, pencilmark)) Search();
+        *num_guesses = num_guesses_;
+        if (num_solutions_ > 0) memcpy(solution, solution_, 81);
+        return num_solutions_;
+    }
+
+private:
+    // the encoding, fixed after setup.
+    vector<Cardinality> constraints_;
+    // constraints containing each literal, which are updated when it becomes false.
+    vector<vector<uint32_t>> occurs_ = vector<vector<uint32_t>>(2 * kNumVars);
+
+    // per puzzle.
+    vector<int> num_false_;
+    vector<Clause> clauses_;
+    vector<uint32_t> free_clauses_;
+    vector<vector<uint32_t>> watches_ = vector<vector<uint32_t>>(2 * kNumVars);
+    size_t num_learned_ = 0;
+    size_t max_learned_ = kInitialMaxLearned;
+
+    int8_t value_[kNumVars]; // -1 unassigned, else the truth value
+    bool saved_phase_[kNumVars];
+    int level_[kNumVars];
+    int trail_pos_[kNumVars];
+    ReasonRef reason_[kNumVars];
+    vector<Lit> trail_;
+    vector<int> trail_lim_;
+    size_t queue_head_ = 0;
+
+    double activity_[kNumVars];
+    double var_inc_ = 1.0;
+    double clause_inc_ = 1.0;
+    vector<Var> heap_;
+    vector<int> heap_index_;
+
+    bool seen_[kNumVars];
+    vector<Lit> learned_;
+    vector<Lit> explanation_;
+
+    size_t limit_ = 1;
+    size_t num_guesses_ = 0;
+    size_t num_solutions_ = 0;
+    char solution_[81];
+
+    ///////////////////////////////////////////////
+    // constraint setup
+    ///////////////////////////////////////////////
+
+    void AddAtLeast(const vector<Lit> &lits, int min) {
+        uint32_t index = constraints_.size();
+        constraints_.push_back(Cardinality{lits, (int) lits.size() - min});
+        for (Lit literal : lits) occurs_[literal].push_back(index);
+    }
+
+    void AddExactlyNConstraint(const vector<Lit> &lits, int n) {
+        AddAtLeast(lits, n);
+        vector<Lit> negations;
+        for (Lit literal : lits) negations.push_back(Not(literal));
+        AddAtLeast(negations, (int) lits.size() - n);
+    }
+
+    // the same constraints as SolverDpllTriadScc::SetupConstraints.
+    void SetupConstraints() {
+        for (int box = 0; box < 9; box++) {
+            for (int elem = 0; elem < 15; elem++) {
+                vector<Lit> lits;
+                for (int val = 0; val < 9; val++) lits.push_back(Literal(box, elem, val));
+                AddExactlyNConstraint(lits, IsCell(elem) ? 1 : 3);
+            }
+            for (int val = 0; val < 9; val++) {
+                for (int i = 0; i < 3; i++) {
+                    vector<Lit> h_triad, v_triad;
+                    for (int j = 0; j < 3; j++) {
+                        h_triad.push_back(Literal(box, i * 4 + j, val));
+                        v_triad.push_back(Literal(box, i + j * 4, val));
+                    }
+                    h_triad.push_back(Not(Literal(box, i * 4 + 3, val)));
+                    v_triad.push_back(Not(Literal(box, i + 12, val)));
+                    AddExactlyNConstraint(h_triad, 1);
+                    AddExactlyNConstraint(v_triad, 1);
+                }
+            }
+        }
+        for (int val = 0; val < 9; val++) {
+            for (int band = 0; band < 3; band++) {
+                for (int i = 0; i < 3; i++) {
+                    vector<Lit> h_within, h_across, v_within, v_across;
+                    for (int j = 0; j < 3; j++) {
+                        h_within.push_back(Literal(band * 3 + i, j * 4 + 3, val));
+                        h_across.push_back(Literal(band * 3 + j, i * 4 + 3, val));
+                        v_within.push_back(Literal(i * 3 + band, j + 12, val));
+                        v_across.push_back(Literal(j * 3 + band, i + 12, val));
+                    }
+                    AddExactlyNConstraint(h_within, 1);
+                    AddExactlyNConstraint(h_across, 1);
+                    AddExactlyNConstraint(v_within, 1);
+                    AddExactlyNConstraint(v_across, 1);
+                }
+            }
+        }
+    }
+
+    void Reset() {
+        num_false_.assign(constraints_.size(), 0);
+        clauses_.clear();
+        free_clauses_.clear();
+        for (auto &watch_list : watches_) watch_list.clear();
+        num_learned_ = 0;
+        max_learned_ = kInitialMaxLearned;
+        trail_.clear();
+        trail_lim_.clear();
+        queue_head_ = 0;
+        var_inc_ = 1.0;
+        clause_inc_ = 1.0;
+        heap_.clear();
+        for (Var var = 0; var < kNumVars; var++) {
+            value_[var] = -1;
+            saved_phase_[var] = true;
+            activity_[var] = 0.0;
+            seen_[var] = false;
+            heap_index_[var] = -1;
+            if ((var / 9) % kNumElems != 15) HeapInsert(var);
+        }
+    }
+
+    ///////////////////////////////////////////////
+    // assignment and propagation
+    ///////////////////////////////////////////////
+
+    // -1 if unassigned, else whether the literal holds.
+    int LitValue(Lit literal) const {
+        int8_t value = value_[VarOf(literal)];
+        return value < 0 ? -1 : value ^ (int) (literal & 1u);
+    }
+
+    int DecisionLevel() const { return (int) trail_lim_.size(); }
+
+    void Enqueue(Lit literal, ReasonRef reason) {
+        Var var = VarOf(literal);
+        value_[var] = (int8_t) !(literal & 1u);
+        level_[var] = DecisionLevel();
+        trail_pos_[var] = (int) trail_.size();
+        reason_[var] = reason;
+        trail_.push_back(literal);
+    }
+
+    // returns the conflicting constraint or clause, or kNoReason.
+    ReasonRef Propagate() {
+        while (queue_head_ < trail_.size()) {
+            Lit falsified = Not(trail_[queue_head_++]);
+            // count the literal against all of its constraints before checking any, so that
+            // Backtrack can undo exactly the counts of the literals we've dequeued.
+            const vector<uint32_t> &occurs = occurs_[falsified];
+            for (uint32_t index : occurs) num_false_[index]++;
+            for (uint32_t index : occurs) {
+                const Cardinality &constraint = constraints_[index];
+                if (num_false_[index] > constraint.max_false) return index;
+                if (num_false_[index] == constraint.max_false) {
+                    for (Lit literal : constraint.lits) {
+                        if (LitValue(literal) < 0) Enqueue(literal, index);
+                    }
+                }
+            }
+            ReasonRef conflict = PropagateClauses(falsified);
+            if (conflict != kNoReason) return conflict;
+        }
+        return kNoReason;
+    }
+
+    ReasonRef PropagateClauses(Lit falsified) {
+        vector<uint32_t> &watch_list = watches_[falsified];
+        size_t keep = 0;
+        for (size_t i = 0; i < watch_list.size(); i++) {
+            uint32_t clause_index = watch_list[i];
+            vector<Lit> &lits = clauses_[clause_index].lits;
+            if (lits[0] == falsified) swap(lits[0], lits[1]);
+            if (LitValue(lits[0]) == 1) {
+                watch_list[keep++] = clause_index;
+                continue;
+            }
+            bool moved = false;
+            for (size_t k = 2; k < lits.size(); k++) {
+                if (LitValue(lits[k]) != 0) {
+                    swap(lits[1], lits[k]);
+                    watches_[lits[1]].push_back(clause_index);
+                    moved = true;
+                    break;
+                }
+            }
+            if (moved) continue;
+            watch_list[keep++] = clause_index;
+            if (LitValue(lits[0]) == 0) {
+                while (++i < watch_list.size()) watch_list[keep++] = watch_list[i];
+                watch_list.resize(keep);
+                return kClauseRef | clause_index;
+            }
+            Enqueue(lits[0], kClauseRef | clause_index);
+        }
+        watch_list.resize(keep);
+        return kNoReason;
+    }
+
+    void Backtrack(int level) {
+        if (DecisionLevel() <= level) return;
+        size_t new_size = trail_lim_[level];
+        for (size_t i = trail_.size(); i-- > new_size;) {
+            Lit literal = trail_[i];
+            if (i < queue_head_) {
+                for (uint32_t index : occurs_[Not(literal)]) num_false_[index]--;
+            }
+            Var var = VarOf(literal);
+            saved_phase_[var] = !(literal & 1u);
+            value_[var] = -1;
+            HeapInsert(var);
+        }
+        trail_.resize(new_size);
+        trail_lim_.resize(level);
+        queue_head_ = new_size;
+    }
+
+    ///////////////////////////////////////////////
+    // conflict analysis
+    ///////////////////////////////////////////////
+
+    // fills explanation_ with false literals that, with the reason, imply `implied` (or, if
+    // implied is kNoLit, that the reason is violated).
+    void Explain(ReasonRef reason, Lit implied) {
+        explanation_.clear();
+        if (reason & kClauseRef) {
+            Clause &clause = clauses_[reason & ~kClauseRef];
+            if (!clause.permanent) clause.activity += clause_inc_;
+            for (Lit literal : clause.lits) {
+                if (literal != implied) explanation_.push_back(literal);
+            }
+        } else {
+            // a cardinality constraint implied this literal once enough of the others were false.
+            int before = implied == kNoLit ? INT32_MAX : trail_pos_[VarOf(implied)];
+            for (Lit literal : constraints_[reason].lits) {
+                if (LitValue(literal) == 0 && trail_pos_[VarOf(literal)] < before) {
+                    explanation_.push_back(literal);
+                }
+            }
+        }
+    }
+
+    // derives the first-UIP clause for the conflict into learned_, with the asserting literal
+    // first and a literal from the backjump level second. returns the backjump level.
+    int Analyze(ReasonRef conflict) {
+        learned_.assign(1, kNoLit);
+        int at_current_level = 0;
+        Lit implied = kNoLit;
+        size_t index = trail_.size();
+        ReasonRef reason = conflict;
+        do {
+            Explain(reason, implied);
+            for (Lit literal : explanation_) {
+                Var var = VarOf(literal);
+                if (seen_[var] || level_[var] == 0) continue;
+                seen_[var] = true;
+                BumpVar(var);
+                if (level_[var] == DecisionLevel()) {
+                    at_current_level++;
+                } else {
+                    learned_.push_back(literal);
+                }
+            }
+            while (!seen_[VarOf(trail_[--index])]) {}
+            implied = trail_[index];
+            seen_[VarOf(implied)] = false;
+            reason = reason_[VarOf(implied)];
+        } while (--at_current_level > 0);
+        learned_[0] = Not(implied);
+
+        int backjump_level = 0;
+        size_t max_index = 1;
+        for (size_t i = 1; i < learned_.size(); i++) {
+            seen_[VarOf(learned_[i])] = false;
+            if (level_[VarOf(learned_[i])] > backjump_level) {
+                backjump_level = level_[VarOf(learned_[i])];
+                max_index = i;
+            }
+        }
+        if (learned_.size() > 1) swap(learned_[1], learned_[max_index]);
+        return backjump_level;
+    }
+
+    uint32_t AddClause(const vector<Lit> &lits, bool permanent) {
+        uint32_t index;
+        if (!free_clauses_.empty()) {
+            index = free_clauses_.back();
+            free_clauses_.pop_back();
+        } else {
+            index = clauses_.size();
+            clauses_.emplace_back();
+        }
+        Clause &clause = clauses_[index];
+        clause.lits = lits;
+        clause.activity = clause_inc_;
+        clause.permanent = permanent;
+        clause.deleted = false;
+        watches_[lits[0]].push_back(index);
+        watches_[lits[1]].push_back(index);
+        if (!permanent) num_learned_++;
+        return index;
+    }
+
+    // backjumps and asserts lits[0], which must be the clause's only literal above the
+    // second highest level in it.
+    void LearnAndAssert(const vector<Lit> &lits, int backjump_level, bool permanent) {
+        Backtrack(backjump_level);
+        if (lits.size() == 1) {
+            Enqueue(lits[0], kNoReason);
+        } else {
+            Enqueue(lits[0], kClauseRef | AddClause(lits, permanent));
+        }
+    }
+
+    bool Locked(uint32_t index) const {
+        Lit first = clauses_[index].lits[0];
+        return LitValue(first) == 1 && reason_[VarOf(first)] == (kClauseRef | index);
+    }
+
+    // deletes the less active half of the deletable learned clauses.
+    void ReduceLearned() {
+        vector<uint32_t> candidates;
+        for (uint32_t i = 0; i < clauses_.size(); i++) {
+            const Clause &clause = clauses_[i];
+            if (!clause.deleted && !clause.permanent && clause.lits.size() > 2 && !Locked(i)) {
+                candidates.push_back(i);
+            }
+        }
+        sort(candidates.begin(), candidates.end(), [&](uint32_t a, uint32_t b) {
+            return clauses_[a].activity < clauses_[b].activity;
+        });
+        for (size_t i = 0; i < candidates.size() / 2; i++) {
+            Clause &clause = clauses_[candidates[i]];
+            clause.deleted = true;
+            clause.lits.clear();
+            free_clauses_.push_back(candidates[i]);
+            num_learned_--;
+        }
+        for (auto &watch_list : watches_) {
+            watch_list.erase(remove_if(watch_list.begin(), watch_list.end(), [&](uint32_t i) {
+                return clauses_[i].deleted;
+            }), watch_list.end());
+        }
+        max_learned_ = min(kMaxLearned, (size_t) (max_learned_ * kLearnedGrowth));
+    }
+
+    ///////////////////////////////////////////////
+    // branching
+    ///////////////////////////////////////////////
+
+    void BumpVar(Var var) {
+        if ((activity_[var] += var_inc_) > 1e100) {
+            for (double &activity : activity_) activity *= 1e-100;
+            var_inc_ *= 1e-100;
+        }
+        if (heap_index_[var] >= 0) HeapUp(heap_index_[var]);
+    }
+
+    void DecayActivities() {
+        var_inc_ /= 0.95;
+        clause_inc_ /= 0.999;
+        if (clause_inc_ > 1e20) {
+            for (Clause &clause : clauses_) clause.activity *= 1e-20;
+            clause_inc_ *= 1e-20;
+        }
+    }
+
+    void HeapUp(int i) {
+        Var var = heap_[i];
+        while (i > 0 && activity_[heap_[(i - 1) / 2]] < activity_[var]) {
+            heap_[i] = heap_[(i - 1) / 2];
+            heap_index_[heap_[i]] = i;
+            i = (i - 1) / 2;
+        }
+        heap_[i] = var;
+        heap_index_[var] = i;
+    }
+
+    void HeapDown(int i) {
+        Var var = heap_[i];
+        int size = (int) heap_.size();
+        while (2 * i + 1 < size) {
+            int child = 2 * i + 1;
+            if (child + 1 < size && activity_[heap_[child + 1]] > activity_[heap_[child]]) child++;
+            if (activity_[heap_[child]] <= activity_[var]) break;
+            heap_[i] = heap_[child];
+            heap_index_[heap_[i]] = i;
+            i = child;
+        }
+        heap_[i] = var;
+        heap_index_[var] = i;
+    }
+
+    void HeapInsert(Var var) {
+        if (heap_index_[var] >= 0) return;
+        heap_.push_back(var);
+        HeapUp((int) heap_.size() - 1);
+    }
+
+    Var HeapPop() {
+        Var top = heap_[0];
+        heap_index_[top] = -1;
+        heap_[0] = heap_.back();
+        heap_.pop_back();
+        if (!heap_.empty()) HeapDown(0);
+        return top;
+    }
+
+    // the most active unassigned variable, in its saved phase (initially positive, which
+    // places a value rather than eliminating one).
+    Lit ChooseBranchLiteral() {
+        while (true) {
+            Var var = HeapPop();
+            if (value_[var] < 0) return 2 * var + (saved_phase_[var] ? 0 : 1);
+        }
+    }
+
+    ///////////////////////////////////////////////
+    // search
+    ///////////////////////////////////////////////
+
+    bool InitializePuzzle(const char *input, bool pencilmark) {
+        for (int i = 0; i < 81; i++) {
+            int box = i / 27 * 3 + (i % 9) / 3;
+            int elm = ((i / 9) % 3) * 4 + (i % 3);
+            for (int val = 0; val < 9; val++) {
+                Lit literal;
+                if (pencilmark) {
+                    if (input[i * 9 + val] != '.') continue;
+                    literal = Not(Literal(box, elm, val));
+                } else {
+                    if (input[i] != '1' + val) continue;
+                    literal = Literal(box, elm, val);
+                }
+                if (LitValue(literal) == 0) return false;
+                if (LitValue(literal) < 0) Enqueue(literal, kNoReason);
+            }
+        }
+        return true;
+    }
+
+    void RecordSolution() {
+        for (int i = 0; i < 81; i++) {
+            int box = i / 27 * 3 + (i % 9) / 3;
+            int elm = ((i / 9) % 3) * 4 + (i % 3);
+            for (int val = 0; val < 9; val++) {
+                if (LitValue(Literal(box, elm, val)) == 1) solution_[i] = char('1' + val);
+            }
+        }
+    }
+
+    void Search() {
+        int restarts = 0;
+        int conflicts_until_restart = Luby(0) * kRestartUnit;
+        while (true) {
+            ReasonRef conflict = Propagate();
+            if (conflict != kNoReason) {
+                if (DecisionLevel() == 0) return;
+                int backjump_level = Analyze(conflict);
+                LearnAndAssert(learned_, backjump_level, false);
+                DecayActivities();
+                if (--conflicts_until_restart == 0) {
+                    conflicts_until_restart = Luby(++restarts) * kRestartUnit;
+                    Backtrack(0);
+                }
+                if (num_learned_ >= max_learned_) ReduceLearned();
+                continue;
+            }
+            if (trail_.size() == kNumUsedVars) {
+                if (++num_solutions_ == 1) RecordSolution();
+                if (num_solutions_ == limit_ || DecisionLevel() == 0) return;
+                // block this solution's decisions, latest first, and look for another.
+                learned_.clear();
+                for (int level = DecisionLevel(); level > 0; level--) {
+                    learned_.push_back(Not(trail_[trail_lim_[level - 1]]));
+                }
+                LearnAndAssert(learned_, DecisionLevel() - 1, true);
+                continue;
+            }
+            num_guesses_++;
+            trail_lim_.push_back((int) trail_.size());
+            Enqueue(ChooseBranchLiteral(), kNoReason);
+        }
+    }
+};
+
+} // namespace
+
+extern "C" size_t DrakeSolverTriadCdcl(
+    const char* input, size_t limit, uint32_t /*flags*/, char* solution, size_t* num_guesses) {
+  thread_local SolverTriadCdcl solver;
+  return solver.SolveSudoku(input, limit, solution, num_guesses);
+}
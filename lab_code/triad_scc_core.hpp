@@ -4,8 +4,11 @@
 #include <array>
 #include <bitset>
 #include <cassert>
+#include <chrono>
 #include <climits>
+#include <cstdint>
 #include <cstring>
+#include <deque>
 #include <iostream>
 #include <map>
 #include <set>
@@ -16,26 +19,74 @@ using namespace std;
 
 namespace {
 
-constexpr int kNumBoxes = 9;
-constexpr int kNumPosClausesPerBox = 16; // 9 cells, 6 triads, 1 slack
-constexpr int kNumValues = 9;
+// a board made of box_dim x box_dim boxes: box_dim^2 boxes, values, rows and columns. each
+// box has (box_dim + 1)^2 elements: its cells, plus box_dim horizontal and box_dim vertical
+// n-ads (the triads of a 9x9 board) for the row and column segments within the box, plus one
+// unused slack element.
+template<int box_dim>
+struct BoardGeometry {
+    static constexpr int kBoxDim = box_dim;
+    static constexpr int kNumBoxes = box_dim * box_dim;
+    static constexpr int kNumPosClausesPerBox = (box_dim + 1) * (box_dim + 1);
+    static constexpr int kNumValues = box_dim * box_dim;
+    static constexpr int kNumCells = kNumValues * kNumValues;
 
-constexpr uint16_t kNumLiterals = kNumBoxes * kNumPosClausesPerBox * kNumValues * 2;
-constexpr uint16_t kAllAsserted = kNumBoxes * (kNumPosClausesPerBox - 1) * kNumValues;
+    static constexpr uint16_t kNumLiterals = kNumBoxes * kNumPosClausesPerBox * kNumValues * 2;
+    static constexpr uint16_t kAllAsserted = kNumBoxes * (kNumPosClausesPerBox - 1) * kNumValues;
+};
+
+// the standard 9x9 board: 9 cells, 6 triads and 1 slack element per box.
+constexpr int kNumBoxes = BoardGeometry<3>::kNumBoxes;
+constexpr int kNumPosClausesPerBox = BoardGeometry<3>::kNumPosClausesPerBox;
+constexpr int kNumValues = BoardGeometry<3>::kNumValues;
+constexpr int kNumCells = BoardGeometry<3>::kNumCells;
+
+constexpr uint16_t kNumLiterals = BoardGeometry<3>::kNumLiterals;
+constexpr uint16_t kAllAsserted = BoardGeometry<3>::kAllAsserted;
+
+// values are written '1'..'9' and then 'A'..'P', so 9x9 puzzles keep their usual digits and
+// 16x16 and 25x25 puzzles use the first 16 or 25 symbols.
+constexpr char kValueSymbols[] = "123456789ABCDEFGHIJKLMNOP";
+
+// the value written as symbol, or -1 for anything else (e.g. '.' for an empty cell).
+inline int SymbolValue(char symbol) {
+    if (symbol >= '1' && symbol <= '9') return symbol - '1';
+    if (symbol >= 'A' && symbol <= 'P') return symbol - 'A' + 9;
+    if (symbol >= 'a' && symbol <= 'p') return symbol - 'a' + 9;
+    return -1;
+}
 
 typedef uint32_t ClauseId;
 typedef uint32_t LiteralId;
 constexpr uint32_t kNoLiteral = UINT32_MAX;
 
+// solution modes. the search is instantiated per mode so the stopping test in BranchOnLiteral
+// compares against a constant for the common limits (first solution, and uniqueness checks
+// that stop at two). kCountSolutions stops at the runtime limit_.
+enum SolutionMode {
+    kCountSolutions = 0,
+    kFirstSolution = 1,
+    kUniqueSolution = 2,
+};
+
 template<int literals>
 class FastBitset {
-    uint64_t bits[literals / 64 + 1]{};
+public:
+    static constexpr int kNumWords = literals / 64 + 1;
+
+private:
+    uint64_t bits[kNumWords]{};
 
 public:
     void set(uint32_t index) {
         bits[index >> 6u] |= (1ul << (index & 63u));
     }
 
+    // set without a branch on value, for when it's unpredictable.
+    void set_if(uint32_t index, bool value) {
+        bits[index >> 6u] |= ((uint64_t) value << (index & 63u));
+    }
+
     bool operator[](uint32_t index) const {
         return bits[index >> 6u] & (1ul << (index & 63u));
     }
@@ -44,27 +95,255 @@ public:
         auto positive = index & ~1u;
         return bits[positive >> 6u] & (3ul << (positive & 63u));
     }
+
+    const uint64_t *words() const {
+        return bits;
+    }
+
+    uint64_t *words() {
+        return bits;
+    }
+
+    // keep only the bits also set in other.
+    void intersect(const FastBitset &other) {
+        for (int i = 0; i < kNumWords; i++) bits[i] &= other.bits[i];
+    }
 };
 
-struct State {
+template<int literals>
+struct BasicState {
     // 1s for asserted literals, 0s for literals negated or unknown
-    FastBitset<kNumLiterals> asserted;
+    FastBitset<literals> asserted;
     // the number of literals that can be eliminated before the clause produces binary implications
     vector<uint16_t> clause_free_literals;
     // the number of implications for a given literal. we will not copy the implication lists
     // themselves as part of the state. instead the global state has a vector for each literal
     // that we use as a stack, and these counts are the stack pointers.
-    array<uint16_t, kNumLiterals> implication_counts;
+    array<uint16_t, literals> implication_counts;
     // number of literals asserted. we are done when this equals kAllAsserted.
     uint32_t num_asserted = 0;
 
-    State() : asserted{}, clause_free_literals{}, implication_counts{} {}
+    BasicState() : asserted{}, clause_free_literals{}, implication_counts{} {}
+
+    BasicState(const BasicState &prior_state) = default;
+};
+
+using State = BasicState<kNumLiterals>;
 
-    State(const State &prior_state) = default;
+// the scans the solver makes over whole-puzzle state, pulled out so that vectorized variants
+// (see triad_scc_simd.hpp) can replace them. these are the straightforward scalar versions.
+struct ScalarKernels {
+    // returns the index of the first cell clause with the fewest free literals. cell clauses
+    // are numbered 0..num_cells-1, and solved cells have wrapped around to large counts.
+    template<int num_cells>
+    static int MinFreeCell(const uint16_t *cell_free_literals) {
+        int min_free = INT8_MAX, which_cell = 0;
+        for (int cell = 0; cell < num_cells; cell++) {
+            if (cell_free_literals[cell] < min_free) {
+                min_free = cell_free_literals[cell];
+                which_cell = cell;
+            }
+        }
+        return which_cell;
+    }
+
+    // calls visit(literal) in increasing order for each positive literal that may still be
+    // undetermined, stopping early if visit returns false. visit must re-check the literal
+    // since it may be asserted by earlier visits.
+    template<int literals, class Visit>
+    static bool ForEachUndecidedPositive(const FastBitset<literals> & /*asserted*/, Visit visit) {
+        for (uint16_t literal = 0; literal < literals; literal += 2) {
+            if (!visit(literal)) return false;
+        }
+        return true;
+    }
 };
 
-template<class Adj> 
+// the singles pre-pass (configuration bit 3). most puzzles in the unbiased datasets need no
+// guesses, and many fall to naked and hidden singles alone, without the clause setup, the
+// AssertAll waves and the SCC passes. the pre-pass propagates singles on one candidate mask
+// per cell, straight from the input. it either settles the puzzle, solved (every placement
+// was forced, so the solution is unique) or refuted, or leaves it open with candidates that
+// seed the SCC search (see SolverDpllTriadScc::SolveSudoku).
+enum PrepassOutcome {
+    kPrepassRefuted,
+    kPrepassSolved,
+    kPrepassOpen
+};
+
+template<class Geometry = BoardGeometry<3>>
+class SinglesPrepass {
+public:
+    static constexpr int kBoxDim = Geometry::kBoxDim;
+    static constexpr int kNumValues = Geometry::kNumValues;
+    static constexpr int kNumCells = Geometry::kNumCells;
+    static constexpr int kNumUnits = 3 * kNumValues;
+    static constexpr uint32_t kAllValues = (uint32_t) ((1ull << kNumValues) - 1);
+
+    // the input is as for SolverDpllTriadScc::SolveSudoku.
+    PrepassOutcome Run(const char *input) {
+        num_pending_ = 0;
+        num_placed_ = 0;
+        placed_ = {};
+        bool ok = input[kNumCells] >= '.' ? InitializePencilmark(input) : InitializeClues(input);
+        if (ok) ok = Propagate();
+        if (!ok) return kPrepassRefuted;
+        return num_placed_ == kNumCells ? kPrepassSolved : kPrepassOpen;
+    }
+
+    // the result of a puzzle Run settled, as SolveSudoku returns it.
+    size_t Settle(PrepassOutcome outcome, char *solution, size_t *num_guesses) const {
+        *num_guesses = 0;
+        if (outcome != kPrepassSolved) return 0;
+        for (int i = 0; i < kNumCells; i++) {
+            solution[i] = kValueSymbols[__builtin_ctz(candidates_[i])];
+        }
+        return 1;
+    }
+
+    // the values still possible in a cell, one bit each.
+    uint32_t Candidates(int cell) const {
+        return candidates_[cell];
+    }
+
+private:
+    // the cells of each row, column and box, and the units of each cell.
+    struct Units {
+        array<array<uint16_t, kNumValues>, kNumUnits> cells{};
+        array<array<uint16_t, 3>, kNumCells> of_cell{};
+
+        Units() {
+            for (int i = 0; i < kNumCells; i++) {
+                int row = i / kNumValues, col = i % kNumValues;
+                int box = row / kBoxDim * kBoxDim + col / kBoxDim;
+                int box_pos = row % kBoxDim * kBoxDim + col % kBoxDim;
+                cells[row][col] = cells[kNumValues + col][row] = (uint16_t) i;
+                cells[2 * kNumValues + box][box_pos] = (uint16_t) i;
+                of_cell[i] = {(uint16_t) row, (uint16_t) (kNumValues + col),
+                              (uint16_t) (2 * kNumValues + box)};
+            }
+        }
+    };
+
+    static const Units &GetUnits() {
+        static const Units units;
+        return units;
+    }
+
+    const Units &units_ = GetUnits();
+    array<uint32_t, kNumCells> candidates_{};
+    // the cells down to one candidate and not yet placed. a cell gets there once at most.
+    array<uint16_t, kNumCells> pending_{};
+    int num_pending_ = 0;
+    FastBitset<kNumCells> placed_{};
+    int num_placed_ = 0;
+
+    // narrows a cell to one of its candidates.
+    void Assign(int cell, uint32_t bit) {
+        if (candidates_[cell] & (candidates_[cell] - 1)) pending_[num_pending_++] = (uint16_t) cell;
+        candidates_[cell] = bit;
+    }
+
+    bool InitializeClues(const char *input) {
+        candidates_.fill(kAllValues);
+        for (int i = 0; i < kNumCells; i++) {
+            int val = SymbolValue(input[i]);
+            if (val < 0 || val >= kNumValues) continue;
+            uint32_t bit = 1u << (uint32_t) val;
+            if (!(candidates_[i] & bit)) return false;
+            Assign(i, bit);
+            // place clues as they come, so later clues see their eliminations.
+            if (!PlacePending()) return false;
+        }
+        return true;
+    }
+
+    bool InitializePencilmark(const char *input) {
+        for (int i = 0; i < kNumCells; i++) {
+            uint32_t mask = 0;
+            for (int j = 0; j < kNumValues; j++) {
+                if (input[i * kNumValues + j] != '.') mask |= 1u << (uint32_t) j;
+            }
+            if (mask == 0) return false;
+            candidates_[i] = mask;
+            if (!(mask & (mask - 1))) pending_[num_pending_++] = (uint16_t) i;
+        }
+        return true;
+    }
+
+    // places the pending cells, eliminating their values from their peers (naked singles).
+    bool PlacePending() {
+        while (num_pending_ > 0) {
+            int cell = pending_[--num_pending_];
+            if (placed_[cell]) continue;
+            placed_.set(cell);
+            num_placed_++;
+            uint32_t bit = candidates_[cell];
+            for (uint16_t unit : units_.of_cell[cell]) {
+                for (uint16_t peer : units_.cells[unit]) {
+                    uint32_t mask = candidates_[peer];
+                    if (peer == cell || !(mask & bit)) continue;
+                    mask &= ~bit;
+                    if (mask == 0) return false;
+                    candidates_[peer] = mask;
+                    if (!(mask & (mask - 1))) pending_[num_pending_++] = peer;
+                }
+            }
+        }
+        return true;
+    }
+
+    // assigns each value with one place left in a unit (hidden singles). returns false if a
+    // unit has no place left for some value.
+    bool FindHiddenSingles() {
+        for (const auto &unit : units_.cells) {
+            uint32_t once = 0, twice = 0;
+            for (uint16_t cell : unit) {
+                twice |= once & candidates_[cell];
+                once |= candidates_[cell];
+            }
+            if (once != kAllValues) return false;
+            for (uint32_t hidden = once & ~twice; hidden; hidden &= hidden - 1) {
+                uint32_t bit = hidden & -hidden;
+                bool found = false;
+                for (uint16_t cell : unit) {
+                    if (candidates_[cell] & bit) {
+                        Assign(cell, bit);
+                        found = true;
+                        break;
+                    }
+                }
+                // two hidden values in one cell.
+                if (!found) return false;
+            }
+        }
+        return true;
+    }
+
+    bool Propagate() {
+        while (true) {
+            if (!PlacePending()) return false;
+            if (num_placed_ == kNumCells) return true;
+            if (!FindHiddenSingles()) return false;
+            if (num_pending_ == 0) return true;
+        }
+    }
+};
+
+// Adj is instantiated with Geometry::kNumLiterals (see adjacency.hpp). the board constants
+// below shadow the 9x9 ones at namespace scope.
+template<class Adj, class Kernels = ScalarKernels, class Geometry = BoardGeometry<3>>
 struct SolverDpllTriadScc {
+    static constexpr int kBoxDim = Geometry::kBoxDim;
+    static constexpr int kNumBoxes = Geometry::kNumBoxes;
+    static constexpr int kNumPosClausesPerBox = Geometry::kNumPosClausesPerBox;
+    static constexpr int kNumValues = Geometry::kNumValues;
+    static constexpr int kNumCells = Geometry::kNumCells;
+    static constexpr uint16_t kNumLiterals = Geometry::kNumLiterals;
+    static constexpr uint16_t kAllAsserted = Geometry::kAllAsserted;
+    using State = BasicState<kNumLiterals>;
+    using Prepass = SinglesPrepass<Geometry>;
+
     // this mapping from ClauseId to LiteralId will not change after setup.
     vector<vector<LiteralId>> clauses_to_literals_{};
     // this mapping from LiteralId to ClauseId will not change after setup.
@@ -81,35 +360,72 @@ struct SolverDpllTriadScc {
     // initial state with the correct implication counts. we'll clone this when we begin
     // solving each new puzzle, but this will not change after setup.
     State initial_state_{};
-    // whether to use strongly connected component size as a heuristic for variable selection.
-    bool scc_heuristic_ = true;
-    // whether to apply inferences reached during strongly connected component evaluation.
-    bool scc_inference_ = true;
-    // stop after finding this many solutions.
+    // stop after finding this many solutions (consulted only in kCountSolutions mode).
     size_t limit_ = 1;
     Adj adj_;
 
     size_t num_guesses_ = 0;
     size_t num_solutions_ = 0;
     State result_{};
+    // the state copies of the branches in progress, one per level of the search. a State is
+    // tens of kilobytes on 16x16 and 25x25 boards and a search can be hundreds of branches
+    // deep, too much for the stack. a deque keeps the outer levels in place as it grows.
+    deque<State> branch_states_{};
+    size_t branch_depth_ = 0;
 
-    SolverDpllTriadScc() { SetupConstraints(); adj_.build(clauses_to_literals_, literals_to_clauses_); }
+    // failed-literal probing (configuration bit 2, see Probe), and the number of probes the
+    // current puzzle has left.
+    bool probing_ = false;
+    size_t probes_left_ = 0;
+
+    // an optional budget for each search, in guesses and microseconds (kNoGuessBudget and
+    // kNoTimeBudget for none; see SetBudget). BranchOnLiteral compares num_guesses_ to next_budget_check_ before each
+    // guess, and only then checks the guess budget and reads the clock, so an unbudgeted
+    // search pays one comparison per guess. once the budget runs out, the search unwinds with
+    // what it has found so far and budget_exhausted_ is set.
+    static constexpr size_t kNoGuessBudget = SIZE_MAX;
+    static constexpr uint64_t kNoTimeBudget = UINT64_MAX;
+    size_t guess_budget_ = kNoGuessBudget;
+    uint64_t time_budget_usec_ = kNoTimeBudget;
+    size_t next_budget_check_ = SIZE_MAX;
+    chrono::steady_clock::time_point deadline_{};
+    bool budget_exhausted_ = false;
+    // the state at the first guess of a budgeted search (see PartialGrid).
+    State partial_{};
+
+    SolverDpllTriadScc() {
+        SetupConstraints();
+        NumberCellClausesFirst();
+        adj_.build(clauses_to_literals_, literals_to_clauses_);
+        // each literal is asserted at most once, so AssertAll decrements at most this many
+        // clause counters.
+        size_t num_memberships = 0;
+        for (const auto &literals : clauses_to_literals_) num_memberships += literals.size();
+        triggered_clauses_.resize(num_memberships);
+    }
 
     static void Display(State *state) {
-        string div1 = " +=====+=====+=====+=====+=====+=====+=====+=====+=====+=====+=====+=====+";
-        string div2 = " +-----+-----+-----+-----+-----+-----+-----+-----+-----+-----+-----+-----+";
-        for (int i = 0; i < 12; i++) {
-            cout << (((i % 4) == 0) ? div1 : div2) << endl;
-            for (int vi = 0; vi < 3; vi++) {
-                for (int j = 0; j < 12; j++) {
+        // each element of each box is drawn as a kBoxDim x kBoxDim block of its candidates.
+        constexpr int kElemsPerSide = kBoxDim + 1;
+        constexpr int kSide = kBoxDim * kElemsPerSide;
+        string div1 = " +", div2 = " +";
+        for (int j = 0; j < kSide; j++) {
+            div1 += string(kBoxDim + 2, '=') + "+";
+            div2 += string(kBoxDim + 2, '-') + "+";
+        }
+        for (int i = 0; i < kSide; i++) {
+            cout << (((i % kElemsPerSide) == 0) ? div1 : div2) << endl;
+            for (int vi = 0; vi < kBoxDim; vi++) {
+                for (int j = 0; j < kSide; j++) {
                     cout << " | ";
-                    for (int vj = 0; vj < 3; vj++) {
-                        int box = i / 4 * 3 + j / 4;
-                        int elm = (i % 4) * 4 + (j % 4);
-                        if (state->asserted[Not(Literal(box, elm, vi * 3 + vj))]) {
+                    for (int vj = 0; vj < kBoxDim; vj++) {
+                        int box = i / kElemsPerSide * kBoxDim + j / kElemsPerSide;
+                        int elm = (i % kElemsPerSide) * kElemsPerSide + (j % kElemsPerSide);
+                        int val = vi * kBoxDim + vj;
+                        if (state->asserted[Not(Literal(box, elm, val))]) {
                             cout << " ";
                         } else {
-                            cout << vi * 3 + vj + 1;
+                            cout << kValueSymbols[val];
                         }
                     }
                 }
@@ -130,18 +446,28 @@ struct SolverDpllTriadScc {
     }
 
     // returns a *positive* literal id reflecting the proposition that the given element of the
-    // given box has the given value. boxes and values are numbered 0-8. elements are numbered
-    // based on a 4x4 grid, with the upper-left 3x3 subgrid being the actual 9 cells of the box
-    // and the 3x1 and 1x3 extra column and row being horizontal and vertical triads. The last
-    // element of the 4x4 grid is unused, but remains for indexing convenience.
+    // given box has the given value. boxes and values are numbered 0-8 (on a 9x9 board).
+    // elements are numbered based on a 4x4 grid, with the upper-left 3x3 subgrid being the
+    // actual 9 cells of the box and the 3x1 and 1x3 extra column and row being horizontal and
+    // vertical triads. The last element of the 4x4 grid is unused, but remains for indexing
+    // convenience. larger boards use a (kBoxDim + 1) x (kBoxDim + 1) grid the same way.
     static LiteralId Literal(int box, int elem, int value) {
         // this order strikes the best balance of locality and avoiding division in ValidLiteral
-        return (uint32_t)(2 * (elem + 16 * (value + 9 * box)));
+        return (uint32_t)(2 * (elem + kNumPosClausesPerBox * (value + kNumValues * box)));
     }
 
     // return true if the literal is in use (vs. in the filler space at the end of each box).
+    // on a 9x9 board this is a mask test, since there are 16 elements per box.
     static bool ValidLiteral(LiteralId literal) {
-        return ((literal % 32u) & 0x1eu) != 0x1eu;
+        return (literal / 2u) % kNumPosClausesPerBox != kNumPosClausesPerBox - 1;
+    }
+
+    // the positive literal for the given value (0-based) in the given cell (numbered row-major).
+    static LiteralId CellLiteral(int cell, int value) {
+        int row = cell / kNumValues, col = cell % kNumValues;
+        int box = row / kBoxDim * kBoxDim + col / kBoxDim;
+        int elem = (row % kBoxDim) * (kBoxDim + 1) + col % kBoxDim;
+        return Literal(box, elem, value);
     }
 
     inline void AddImplication(LiteralId from, LiteralId to, State *state) {
@@ -162,7 +488,7 @@ struct SolverDpllTriadScc {
         }
         clauses_to_literals_.push_back(literals);
         initial_state_.clause_free_literals.push_back(literals.size() - 1 - min);
-        if (min == 1 && literals.size() == 9) {
+        if (min == 1 && literals.size() == kNumValues) {
             positive_cell_clauses_.push_back(new_clause_id);
         }
     }
@@ -184,46 +510,52 @@ struct SolverDpllTriadScc {
         }
     }
 
+    // the bracketed counts are for a 9x9 board. on larger boards a triad is an n-ad of kBoxDim
+    // cells, and the constraints are the same with n = kBoxDim.
     void SetupConstraints() {
-        for (int box = 0; box < 9; box++) {
+        constexpr int n = kBoxDim;
+        // the first horizontal n-ad is element n of the box, and the first vertical one
+        // element n * (n + 1).
+        constexpr int kHorizontal = n, kVertical = n * (n + 1);
+        for (int box = 0; box < kNumBoxes; box++) {
             // ExactlyN constraints over values for a given cell or triad [1/9] and [3/9]
-            for (int elem = 0; elem < 15; elem++) {
+            for (int elem = 0; elem < kNumPosClausesPerBox - 1; elem++) {
                 vector<LiteralId> literals;
-                for (int val = 0; val < 9; val++) {
+                for (int val = 0; val < kNumValues; val++) {
                     literals.push_back(Literal(box, elem, val));
                 }
                 // exactly one for normal cells, exactly three for triads
-                if (elem / 4 < 3 && elem % 4 < 3) {
+                if (elem / (n + 1) < n && elem % (n + 1) < n) {
                     AddExactlyNConstraint(literals, 1);
                 } else {
-                    AddExactlyNConstraint(literals, 3);
+                    AddExactlyNConstraint(literals, n);
                 }
             }
             // ExactlyN constraints to define each triad [1/4]
-            for (int val = 0; val < 9; val++) {
-                for (int i = 0; i < 3; i++) {
+            for (int val = 0; val < kNumValues; val++) {
+                for (int i = 0; i < n; i++) {
                     vector<LiteralId> h_triad, v_triad;
-                    for (int j = 0; j < 3; j++) {
-                        h_triad.push_back(Literal(box, i * 4 + j, val));
-                        v_triad.push_back(Literal(box, i + j * 4, val));
+                    for (int j = 0; j < n; j++) {
+                        h_triad.push_back(Literal(box, i * (n + 1) + j, val));
+                        v_triad.push_back(Literal(box, i + j * (n + 1), val));
                     }
-                    h_triad.push_back(Not(Literal(box, i * 4 + 3, val)));
-                    v_triad.push_back(Not(Literal(box, i + 12, val)));
+                    h_triad.push_back(Not(Literal(box, i * (n + 1) + kHorizontal, val)));
+                    v_triad.push_back(Not(Literal(box, i + kVertical, val)));
                     AddExactlyNConstraint(h_triad, 1);
                     AddExactlyNConstraint(v_triad, 1);
                 }
             }
         }
         // ExactlyN constraints over band triads within and across boxes [1/3]
-        for (int val = 0; val < 9; val++) {
-            for (int band = 0; band < 3; band++) {
-                for (int i = 0; i < 3; i++) {
+        for (int val = 0; val < kNumValues; val++) {
+            for (int band = 0; band < n; band++) {
+                for (int i = 0; i < n; i++) {
                     vector<LiteralId> h_within, h_across, v_within, v_across;
-                    for (int j = 0; j < 3; j++) {
-                        h_within.push_back(Literal(band * 3 + i, j * 4 + 3, val));
-                        h_across.push_back(Literal(band * 3 + j, i * 4 + 3, val));
-                        v_within.push_back(Literal(i * 3 + band, j + 12, val));
-                        v_across.push_back(Literal(j * 3 + band, i + 12, val));
+                    for (int j = 0; j < n; j++) {
+                        h_within.push_back(Literal(band * n + i, j * (n + 1) + kHorizontal, val));
+                        h_across.push_back(Literal(band * n + j, i * (n + 1) + kHorizontal, val));
+                        v_within.push_back(Literal(i * n + band, j + kVertical, val));
+                        v_across.push_back(Literal(j * n + band, i + kVertical, val));
                     }
                     AddExactlyNConstraint(h_within, 1);
                     AddExactlyNConstraint(h_across, 1);
@@ -234,6 +566,35 @@ struct SolverDpllTriadScc {
         }
     }
 
+    // renumber clauses so the positive cell clauses take ids 0..80 (0..kNumCells - 1 on other
+    // boards) in their current order. only the ids change; every clause list keeps its order,
+    // so propagation and search visit clauses exactly as before. this keeps the cell counters
+    // scanned when choosing a clause to branch on contiguous at the front of
+    // clause_free_literals.
+    void NumberCellClausesFirst() {
+        size_t num_clauses = clauses_to_literals_.size();
+        vector<ClauseId> new_ids(num_clauses, kNoLiteral);
+        ClauseId next_id = 0;
+        for (ClauseId clause_id : positive_cell_clauses_) new_ids[clause_id] = next_id++;
+        assert(next_id == kNumCells);
+        for (ClauseId clause_id = 0; clause_id < num_clauses; clause_id++) {
+            if (new_ids[clause_id] == kNoLiteral) new_ids[clause_id] = next_id++;
+        }
+
+        vector<vector<LiteralId>> clauses_to_literals(num_clauses);
+        vector<uint16_t> clause_free_literals(num_clauses);
+        for (ClauseId clause_id = 0; clause_id < num_clauses; clause_id++) {
+            clauses_to_literals[new_ids[clause_id]] = std::move(clauses_to_literals_[clause_id]);
+            clause_free_literals[new_ids[clause_id]] = initial_state_.clause_free_literals[clause_id];
+        }
+        clauses_to_literals_ = std::move(clauses_to_literals);
+        initial_state_.clause_free_literals = std::move(clause_free_literals);
+        for (auto &clause_ids : literals_to_clauses_) {
+            for (ClauseId &clause_id : clause_ids) clause_id = new_ids[clause_id];
+        }
+        for (ClauseId &clause_id : positive_cell_clauses_) clause_id = new_ids[clause_id];
+    }
+
     ///////////////////////////////////////////////
     // boolean constraint propagation
     ///////////////////////////////////////////////
@@ -257,7 +618,7 @@ struct SolverDpllTriadScc {
       });
       return;
     }
-    LiteralId surv[16]; int m = 0;
+    LiteralId surv[kNumValues]; int m = 0;
     adj_.for_each_literal_in_clause(clause_id, [&](LiteralId L){
       if (!state->asserted[Not(L)]) surv[m++] = L;
     });
@@ -300,9 +661,12 @@ struct SolverDpllTriadScc {
     LiteralId best_component_literal = kNoLiteral;
     int best_component_size = -1;
 
-    // returns false if visitation finds us to be in an inconsistent state.
+    // returns false if visitation finds us to be in an inconsistent state. scc_inference
+    // controls whether we apply inferences reached during strongly connected component
+    // evaluation.
+    template<bool scc_inference>
     bool SccVisit(LiteralId literal, State *state) {
-        if (scc_inference_) {
+        if (scc_inference) {
             LiteralId common_ancestor = kNoLiteral;
             for (auto ancestor : stack_p) {
                 if (preorder_index[ancestor] <= preorder_index[Not(literal)]) {
@@ -335,10 +699,10 @@ struct SolverDpllTriadScc {
                 // binary clauses that have no effect on inference.
                 continue;
             } else if (preorder_index[implication] == -1) {
-                if (!SccVisit(implication, state)) {
+                if (!SccVisit<scc_inference>(implication, state)) {
                     return false; // back out. we are in an inconsistent state.
                 }
-                if (scc_inference_ && state->asserted.pos_or_neg(literal)) {
+                if (scc_inference && state->asserted.pos_or_neg(literal)) {
                     // visiting an implication and its consequences may have resulted in the
                     // current literal's assertion or negation. either way we can stop.
                     break;
@@ -375,6 +739,7 @@ struct SolverDpllTriadScc {
         return true;
     }
 
+    template<bool scc_inference>
     bool FindStronglyConnectedComponents(State *state) {
         preorder_counter = 0;
         preorder_index.fill(-1);
@@ -386,17 +751,15 @@ struct SolverDpllTriadScc {
         best_component_size = -1;
         // it suffices to explore positive literals as roots since every non-excluded negative
         // literal will be visited and will form the necessary component.
-        for (uint16_t literal = 0; literal < kNumLiterals; literal += 2) {
+        return Kernels::ForEachUndecidedPositive(state->asserted, [&](LiteralId literal) {
             // we want SCCs of the graph of binary clauses, excluding subsumed clauses
             // and clauses that are actually unit due to an asserted negation.
             if (preorder_index[literal] == -1 && ValidLiteral(literal) &&
                 !state->asserted.pos_or_neg(literal)) {
-                if (!SccVisit(literal, state)) {
-                    return false;
-                }
+                return SccVisit<scc_inference>(literal, state);
             }
-        }
-        return true;
+            return true;
+        });
     }
 
     ///////////////////////////////////////////////
@@ -411,14 +774,9 @@ struct SolverDpllTriadScc {
     // find a positive clause with as few undetermined literals as possible and return one
     // such literal. assumes that the puzzle is *not* already solved.
     LiteralId ChooseLiteralToBranchByClause(State *state) {
-        int min_free = INT8_MAX, which_clause = 0;
-        for (ClauseId clause_id : positive_cell_clauses_) {
-            int num_free = state->clause_free_literals[clause_id];
-            if (num_free < min_free) {
-                min_free = num_free;
-                which_clause = clause_id;
-            }
-        }
+        // positive_cell_clauses_ are clauses 0..kNumCells - 1 (see NumberCellClausesFirst).
+        ClauseId which_clause =
+                Kernels::template MinFreeCell<kNumCells>(state->clause_free_literals.data());
         for (LiteralId literal : clauses_to_literals_[which_clause]) {
             if (!state->asserted[Not(literal)]) {
                 return literal;
@@ -427,89 +785,552 @@ struct SolverDpllTriadScc {
         exit(1); // shouldn't be possible if puzzle is unsolved.
     }
 
+    ///////////////////////////////////////////////
+    // failed-literal probing
+    ///////////////////////////////////////////////
+
+    // at most this many probes per puzzle, and per node, where each probe is one tentative
+    // Assert on a scratch state. puzzles solved without guessing never probe at all.
+    static constexpr size_t kProbeBudget = 512;
+    static constexpr int kMaxProbesPerNode = 9;
+
+    enum ProbeResult {
+        kProbeConflict, // the state is inconsistent
+        kProbeProgress, // new literals were asserted, so propagate again before branching
+        kProbeBranch,   // nothing learned, but *branch_literal is the one to guess
+    };
+
+    // tentatively asserts each candidate of the cell with the fewest candidates. a candidate
+    // whose assertion fails is eliminated; if every candidate is probed and succeeds, the
+    // literals they all imply are asserted, since one of them must hold. otherwise, if
+    // choose_branch is set, we branch on the candidate whose assertion implied the most, since
+    // it's the one most likely to be either solved or refuted quickly. (the SCC heuristic's
+    // choice does better than this, so with it on we leave *branch_literal alone.)
+    ProbeResult Probe(State *state, bool choose_branch, LiteralId *branch_literal) {
+        ClauseId which_clause =
+                Kernels::template MinFreeCell<kNumCells>(state->clause_free_literals.data());
+        FastBitset<kNumLiterals> implied_by_all;
+        bool probed_all = true;
+        bool found_failed = false;
+        int num_probed = 0;
+        uint32_t best_gain = 0;
+        for (LiteralId literal : clauses_to_literals_[which_clause]) {
+            if (state->asserted.pos_or_neg(literal)) continue;
+            if (probes_left_ == 0 || num_probed == kMaxProbesPerNode) {
+                probed_all = false;
+                break;
+            }
+            probes_left_--;
+            num_probed++;
+            State scratch = *state;
+            if (!Assert(literal, &scratch)) {
+                found_failed = true;
+                if (!Assert(Not(literal), state)) return kProbeConflict;
+                continue;
+            }
+            if (num_probed == 1) {
+                implied_by_all = scratch.asserted;
+            } else {
+                implied_by_all.intersect(scratch.asserted);
+            }
+            uint32_t gain = scratch.num_asserted - state->num_asserted;
+            if (choose_branch && gain > best_gain) {
+                best_gain = gain;
+                *branch_literal = literal;
+            }
+        }
+        if (found_failed) return kProbeProgress;
+        if (!probed_all || num_probed == 0) return kProbeBranch;
+
+        bool asserted_any = false;
+        const uint64_t *implied_words = implied_by_all.words();
+        const uint64_t *asserted_words = state->asserted.words();
+        for (int i = 0; i < FastBitset<kNumLiterals>::kNumWords; i++) {
+            for (uint64_t bits = implied_words[i] & ~asserted_words[i]; bits; bits &= bits - 1) {
+                LiteralId literal = (LiteralId) (i * 64 + __builtin_ctzll(bits));
+                if (state->asserted[literal]) continue;
+                if (!Assert(literal, state)) return kProbeConflict;
+                asserted_any = true;
+            }
+        }
+        return asserted_any ? kProbeProgress : kProbeBranch;
+    }
+
+    template<int mode>
+    size_t Limit() const {
+        return mode == kCountSolutions ? limit_ : (size_t) mode;
+    }
+
+    // the number of guesses between clock reads for a time budget.
+    static constexpr size_t kClockCheckInterval = 8;
+
+    // sets the budget for the searches that follow: kNoGuessBudget and kNoTimeBudget for no
+    // bound, and zero for none to spend (a search that needs a guess stops before its first).
+    void SetBudget(size_t max_guesses, uint64_t max_microseconds) {
+        guess_budget_ = max_guesses;
+        time_budget_usec_ = max_microseconds;
+    }
+
+    bool Budgeted() const {
+        return guess_budget_ != kNoGuessBudget || time_budget_usec_ != kNoTimeBudget;
+    }
+
+    // called before a guess once num_guesses_ reaches next_budget_check_. returns whether the
+    // budget has run out, and if not, when to check again.
+    bool BudgetExhausted() {
+        if (num_guesses_ >= guess_budget_) return true;
+        next_budget_check_ = guess_budget_;
+        if (time_budget_usec_ != kNoTimeBudget) {
+            if (chrono::steady_clock::now() >= deadline_) return true;
+            next_budget_check_ = min(next_budget_check_, num_guesses_ + kClockCheckInterval);
+        }
+        return false;
+    }
+
+    // the grid as propagated before the budgeted search's first guess, with a value symbol for
+    // each decided cell and '.' for the rest. valid after a search that guessed.
+    void PartialGrid(char *grid) const {
+        for (int i = 0; i < kNumCells; i++) {
+            grid[i] = '.';
+            for (int val = 0; val < kNumValues; val++) {
+                if (partial_.asserted[CellLiteral(i, val)]) {
+                    grid[i] = kValueSymbols[val];
+                }
+            }
+        }
+    }
+
+    template<bool scc_inference, bool scc_heuristic, int mode>
     void BranchOnLiteral(LiteralId literal, State *state) {
-        num_guesses_++;
-        State state_copy = *state;
-        if (Assert(literal, &state_copy)) {
-            CountSolutionsConsistentWithPartialAssignment(&state_copy);
-            if (num_solutions_ == limit_) {
+        if (num_guesses_ >= next_budget_check_) {
+            if (num_guesses_ == 0) partial_ = *state;
+            if (BudgetExhausted()) {
+                budget_exhausted_ = true;
                 return;
             }
         }
+        num_guesses_++;
+        if (branch_depth_ == branch_states_.size()) branch_states_.emplace_back();
+        State &state_copy = branch_states_[branch_depth_++];
+        state_copy = *state;
+        bool done = false;
+        if (Assert(literal, &state_copy)) {
+            CountSolutionsConsistentWithPartialAssignment<scc_inference, scc_heuristic, mode>(
+                    &state_copy);
+            done = num_solutions_ == Limit<mode>() || budget_exhausted_;
+        }
+        branch_depth_--;
+        if (done) return;
         if (Assert(Not(literal), state)) {
-            CountSolutionsConsistentWithPartialAssignment(state);
+            CountSolutionsConsistentWithPartialAssignment<scc_inference, scc_heuristic, mode>(state);
         }
     }
 
+    // the search is templated on configuration and solution mode (see SolveSudoku) so each
+    // combination gets its own specialized copy of the hot loops.
+    template<bool scc_inference, bool scc_heuristic, int mode>
     void CountSolutionsConsistentWithPartialAssignment(State *state) {
-        if (scc_heuristic_ || scc_inference_) {
-            while (state->num_asserted < kAllAsserted) {
-                auto prev_asserted = state->num_asserted;
-                if (!FindStronglyConnectedComponents(state)) return;
-                if (prev_asserted == state->num_asserted) break;
+        while (true) {
+            if (scc_heuristic || scc_inference) {
+                while (state->num_asserted < kAllAsserted) {
+                    auto prev_asserted = state->num_asserted;
+                    if (!FindStronglyConnectedComponents<scc_inference>(state)) return;
+                    if (prev_asserted == state->num_asserted) break;
+                }
             }
-        }
-        if (state->num_asserted == kAllAsserted) {
-            if (++num_solutions_ == 1) {
-                result_ = *state;
+            if (state->num_asserted == kAllAsserted) {
+                if (++num_solutions_ == 1) {
+                    result_ = *state;
+                }
+                return;
             }
-            return;
-        } else {
-            LiteralId branch_literal = scc_heuristic_ ?
+            LiteralId branch_literal = scc_heuristic ?
                                        ChooseLiteralToBranchByComponent(state) :
                                        ChooseLiteralToBranchByClause(state);
-            BranchOnLiteral(branch_literal, state);
+            if (probing_) {
+                ProbeResult probe_result = Probe(state, !scc_heuristic, &branch_literal);
+                if (probe_result == kProbeConflict) return;
+                if (probe_result == kProbeProgress) continue;
+            }
+            BranchOnLiteral<scc_inference, scc_heuristic, mode>(branch_literal, state);
+            return;
         }
     }
 
+    // collects the puzzle's givens (clues, or eliminated candidates for pencilmark input) and
+    // asserts them together with AssertAll instead of propagating after each one. the input
+    // has one value symbol (see kValueSymbols) or '.' per cell, or for pencilmark input
+    // kNumValues characters per cell, with '.' for each eliminated value.
     bool InitializePuzzle(const char *input, bool pencilmark, State *state) {
-        for (int i = 0; i < 81; i++) {
-            int box = i / 27 * 3 + (i % 9) / 3;
-            int elm = ((i / 9) % 3) * 4 + (i % 3);
+        FastBitset<kNumLiterals> givens;
+        CollectGivens(input, pencilmark, &givens);
+        return AssertAll(givens, state);
+    }
+
+    static void CollectGivens(const char *input, bool pencilmark,
+                              FastBitset<kNumLiterals> *givens) {
+        for (int i = 0; i < kNumCells; i++) {
             if (pencilmark) {
-                for (int j = 0; j < 9; j++) {
-                    if (input[i * 9 + j] == '.') {
-                        if (!Assert(Not(Literal(box, elm, j)), state)) return false;
+                for (int j = 0; j < kNumValues; j++) {
+                    if (input[i * kNumValues + j] == '.') {
+                        givens->set(Not(CellLiteral(i, j)));
                     }
                 }
             } else {
-                char digit = input[i];
-                if (digit != '.') {
-                    int val = digit - '1';
-                    if (!Assert(Literal(box, elm, val), state)) return false;
+                int val = SymbolValue(input[i]);
+                if (val >= 0 && val < kNumValues) {
+                    givens->set(CellLiteral(i, val));
+                }
+            }
+        }
+    }
+
+    // asserts what the singles pre-pass decided: each placed value, and each value it ruled
+    // out of a cell.
+    bool InitializeCandidates(const Prepass &prepass, State *state) {
+        FastBitset<kNumLiterals> givens;
+        CollectCandidates(prepass, &givens);
+        return AssertAll(givens, state);
+    }
+
+    static void CollectCandidates(const Prepass &prepass, FastBitset<kNumLiterals> *givens) {
+        for (int i = 0; i < kNumCells; i++) {
+            uint32_t candidates = prepass.Candidates(i);
+            bool placed = !(candidates & (candidates - 1));
+            for (int j = 0; j < kNumValues; j++) {
+                if (!(candidates >> (uint32_t) j & 1u)) {
+                    givens->set(Not(CellLiteral(i, j)));
+                } else if (placed) {
+                    givens->set(CellLiteral(i, j));
                 }
             }
         }
+    }
+
+    // an AssertAll in progress: the wave of literals to assert next and the clauses whose
+    // binary implications are added at the end.
+    struct Propagation {
+        FastBitset<kNumLiterals> wave;
+        vector<ClauseId> deferred_clauses;
+    };
+
+    enum WaveOutcome {
+        kWaveConflict,
+        kWaveNext,
+        kWaveFixpoint
+    };
+
+    // scratch for AssertWave. triggered_clauses_ is sized in the constructor.
+    vector<ClauseId> triggered_clauses_;
+    FastBitset<kNumLiterals> next_wave_;
+    Propagation propagation_;
+
+    // asserts a set of literals and propagates their consequences breadth first, a wave of
+    // literals at a time, reaching the same fixpoint as asserting them one by one. each wave's
+    // asserted bits and count are updated a word at a time and its clause counters in one
+    // pass. the next wave is the implications of this one, plus the remaining literals of any
+    // clause left with exactly its minimum number (fewer is a conflict). this makes the binary
+    // implications Assert adds when a clause reaches its trigger point unnecessary during
+    // propagation, so they are only added at the end, for clauses still at that point.
+    bool AssertAll(const FastBitset<kNumLiterals> &literals, State *state) {
+        propagation_.wave = literals;
+        propagation_.deferred_clauses.clear();
+        WaveOutcome outcome;
+        do {
+            outcome = AssertWave(&propagation_, state);
+        } while (outcome == kWaveNext);
+        if (outcome == kWaveConflict) return false;
+        FinishPropagation(propagation_, state);
         return true;
     }
 
+    // asserts one wave of an AssertAll and computes the next. the waves only read the shared
+    // implication lists (up to the state's counts), so several puzzles' propagations can run
+    // interleaved on one solver, as long as each is finished just before its search.
+    WaveOutcome AssertWave(Propagation *propagation, State *state) {
+        constexpr uint64_t kEvenBits = 0x5555555555555555ul;
+        FastBitset<kNumLiterals> &wave = propagation->wave;
+        uint64_t *wave_words = wave.words();
+        uint64_t *asserted_words = state->asserted.words();
+        uint64_t any_fresh = 0;
+        for (int i = 0; i < FastBitset<kNumLiterals>::kNumWords; i++) {
+            uint64_t word = wave_words[i];
+            // each literal's negation is the adjacent bit of the same word.
+            uint64_t negations = ((word & kEvenBits) << 1u) | ((word >> 1u) & kEvenBits);
+            if (negations & (word | asserted_words[i])) return kWaveConflict;
+            wave_words[i] = word & ~asserted_words[i];
+            asserted_words[i] |= wave_words[i];
+            state->num_asserted += __builtin_popcountll(wave_words[i]);
+            any_fresh |= wave_words[i];
+        }
+        if (!any_fresh) return kWaveFixpoint;
+
+        // a clause's counter reaches 0 at its trigger point and wraps past it when one of
+        // the remaining literals is eliminated. which clauses get there is unpredictable,
+        // so every clause is written to the list and only those are kept.
+        size_t num_triggered = 0;
+        ForEachLiteral(wave, [&](LiteralId literal) {
+            adj_.for_each_clause_of_not_literal(literal, [&](ClauseId clause_id) {
+                uint16_t free_literals = --state->clause_free_literals[clause_id];
+                triggered_clauses_[num_triggered] = clause_id;
+                num_triggered += (uint16_t) (free_literals + 1u) <= 1u;
+            });
+        });
+        next_wave_ = FastBitset<kNumLiterals>();
+        for (size_t i = 0; i < num_triggered; i++) {
+            ClauseId clause_id = triggered_clauses_[i];
+            uint16_t free_literals = state->clause_free_literals[clause_id];
+            if (free_literals == 0) {
+                propagation->deferred_clauses.push_back(clause_id);
+            } else if (free_literals == UINT16_MAX) {
+                adj_.for_each_literal_in_clause(clause_id, [&](LiteralId literal) {
+                    next_wave_.set_if(literal, !state->asserted[Not(literal)]);
+                });
+            } else {
+                return kWaveConflict;
+            }
+        }
+        ForEachLiteral(wave, [&](LiteralId literal) {
+            const auto &implications = literals_to_implications_[literal];
+            uint16_t num_implications = state->implication_counts[literal];
+            for (uint16_t i = 0; i < num_implications; i++) next_wave_.set(implications[i]);
+        });
+        std::swap(wave, next_wave_);
+        return kWaveNext;
+    }
+
+    // prefetches what the propagation's next wave reads first: each literal's clause list and
+    // implication list.
+    void PrefetchWave(const Propagation &propagation) const {
+        ForEachLiteral(propagation.wave, [&](LiteralId literal) {
+            adj_.prefetch_clauses_of_not_literal(literal);
+            __builtin_prefetch(literals_to_implications_[literal].data());
+        });
+    }
+
+    // adds the binary implications of the clauses AssertAll left at their trigger point.
+    void FinishPropagation(const Propagation &propagation, State *state) {
+        for (ClauseId clause_id : propagation.deferred_clauses) {
+            if (state->clause_free_literals[clause_id] == 0) {
+                AddBinaryImplicationsAmongNonEliminated(clause_id, state);
+            }
+        }
+    }
+
+    // calls visit(literal) in increasing order for each literal in the set.
+    template<class Visit>
+    static void ForEachLiteral(const FastBitset<kNumLiterals> &literals, Visit visit) {
+        const uint64_t *words = literals.words();
+        for (int i = 0; i < FastBitset<kNumLiterals>::kNumWords; i++) {
+            for (uint64_t bits = words[i]; bits; bits &= bits - 1) {
+                visit((LiteralId) (i * 64 + __builtin_ctzll(bits)));
+            }
+        }
+    }
+
+    ///////////////////////////////////////////////
+    // cubes
+    ///////////////////////////////////////////////
+
+    // for counting in parallel (see DrakeCountSolutions in drake.cc), the search space is split
+    // into cubes, each a list of decision literals asserted on top of a root state: the puzzle
+    // as set up by InitializeRoot. a search only writes implication entries past the counts of
+    // the state it starts from, so one root serves any number of cubes, as long as the solver
+    // isn't given another puzzle meanwhile. splitting every open cube on the SCC heuristic's
+    // choice and its negation keeps the cubes disjoint and covering.
+    enum CubeOutcome {
+        kCubeRefuted,
+        kCubeSolved,
+        kCubeOpen
+    };
+
+    bool InitializeRoot(const char *input, State *root) {
+        *root = initial_state_;
+        return InitializePuzzle(input, input[kNumCells] >= '.', root);
+    }
+
+    // asserts the cube on a copy of root and runs the SCC passes that begin each search node.
+    // if the cube stays open, *literal is the literal to split it on.
+    CubeOutcome ExpandCube(const State &root, const vector<LiteralId> &cube, LiteralId *literal) {
+        State state = root;
+        for (LiteralId cube_literal : cube) {
+            if (!Assert(cube_literal, &state)) return kCubeRefuted;
+        }
+        while (state.num_asserted < kAllAsserted) {
+            auto prev_asserted = state.num_asserted;
+            if (!FindStronglyConnectedComponents<true>(&state)) return kCubeRefuted;
+            if (prev_asserted == state.num_asserted) break;
+        }
+        if (state.num_asserted == kAllAsserted) return kCubeSolved;
+        *literal = ChooseLiteralToBranchByComponent(&state);
+        return kCubeOpen;
+    }
+
+    // counts the solutions within the cube, up to limit.
+    size_t CountCube(const State &root, const vector<LiteralId> &cube, size_t limit,
+                     uint32_t configuration, size_t *num_guesses) {
+        BeginSearch(limit, configuration);
+        *num_guesses = 0;
+        State state = root;
+        for (LiteralId literal : cube) {
+            if (!Assert(literal, &state)) return 0;
+        }
+        Search(configuration, &state);
+        *num_guesses = num_guesses_;
+        return num_solutions_;
+    }
+
     ///////////////////////////////////////////////
     // entry
     ///////////////////////////////////////////////
 
-    size_t SolveSudoku(const char *input, size_t limit, uint32_t configuration,
-                       char *solution, size_t *num_guesses) {
+    template<bool scc_inference, bool scc_heuristic>
+    void Search(State *state) {
+        switch (limit_) {
+            case kFirstSolution:
+                CountSolutionsConsistentWithPartialAssignment<
+                        scc_inference, scc_heuristic, kFirstSolution>(state);
+                break;
+            case kUniqueSolution:
+                CountSolutionsConsistentWithPartialAssignment<
+                        scc_inference, scc_heuristic, kUniqueSolution>(state);
+                break;
+            default:
+                CountSolutionsConsistentWithPartialAssignment<
+                        scc_inference, scc_heuristic, kCountSolutions>(state);
+        }
+    }
+
+    // dispatch on the runtime configuration to the specialized search. configuration bit 0
+    // enables SCC inference and bit 1 the SCC branching heuristic. bit 2 (failed-literal
+    // probing) is checked once per branch point, in CountSolutionsConsistentWithPartialAssignment.
+    void Search(uint32_t configuration, State *state) {
+        switch (configuration & 3u) {
+            case 0: Search<false, false>(state); break;
+            case 1: Search<true, false>(state); break;
+            case 2: Search<false, true>(state); break;
+            default: Search<true, true>(state);
+        }
+    }
+
+    void BeginSearch(size_t limit, uint32_t configuration) {
         limit_ = limit;
-        scc_inference_ = (configuration & 1u) > 0;
-        scc_heuristic_ = (configuration & 2u) > 0;
-        bool pencilmark = input[81] >= '.';
         num_solutions_ = 0;
-        *num_guesses = num_guesses_ = 0;
-
+        num_guesses_ = 0;
+        probing_ = (configuration & 4u) != 0;
+        probes_left_ = kProbeBudget;
         result_ = initial_state_;
+        budget_exhausted_ = false;
+        // a budgeted search checks before its first guess, to take the partial_ snapshot.
+        next_budget_check_ = Budgeted() ? 0 : SIZE_MAX;
+        if (time_budget_usec_ != kNoTimeBudget) {
+            // clamped to about a year, so the deadline can't overflow the clock.
+            uint64_t usec = time_budget_usec_ < (1ull << 45u) ? time_budget_usec_ : (1ull << 45u);
+            deadline_ = chrono::steady_clock::now() + chrono::microseconds(usec);
+        }
+    }
+
+    // configuration bit 3 runs the singles pre-pass first (see SinglesPrepass).
+    size_t SolveSudoku(const char *input, size_t limit, uint32_t configuration,
+                       char *solution, size_t *num_guesses) {
+        if (configuration & 8u) {
+            // puzzles the pre-pass settles never reach BeginSearch, so clear the last call's.
+            budget_exhausted_ = false;
+            Prepass prepass;
+            PrepassOutcome outcome = prepass.Run(input);
+            if (outcome != kPrepassOpen) return prepass.Settle(outcome, solution, num_guesses);
+            return SolveSudoku(prepass, limit, configuration, solution, num_guesses);
+        }
+        BeginSearch(limit, configuration);
+        *num_guesses = 0;
         State state = initial_state_;
+        if (!InitializePuzzle(input, input[kNumCells] >= '.', &state)) {
+            return 0;
+        }
+        return Solve(configuration, &state, solution, num_guesses);
+    }
 
-        if (!InitializePuzzle(input, pencilmark, &state)) {
+    // solves a puzzle the pre-pass left open, from its candidates.
+    size_t SolveSudoku(const Prepass &prepass, size_t limit, uint32_t configuration,
+                       char *solution, size_t *num_guesses) {
+        BeginSearch(limit, configuration);
+        *num_guesses = 0;
+        State state = initial_state_;
+        if (!InitializeCandidates(prepass, &state)) {
             return 0;
         }
-        CountSolutionsConsistentWithPartialAssignment(&state);
+        return Solve(configuration, &state, solution, num_guesses);
+    }
+
+    // a puzzle of SolveInterleaved. those settled by the pre-pass or refuted while propagating
+    // end up at kWaveConflict, with their results already set, and skip the search.
+    struct InterleavedPuzzle {
+        Propagation propagation;
+        State state;
+        WaveOutcome outcome;
+    };
+    vector<InterleavedPuzzle> interleaved_;
+
+    // solves num puzzles as SolveSudoku does each, with their initial propagations (the bulk of
+    // the work for most puzzles) interleaved a wave at a time: after each wave a puzzle
+    // prefetches what its next one reads, and the other puzzles' waves run while that loads.
+    // then the searches run one after another, each first adding its own propagation's binary
+    // implications to the shared lists.
+    void SolveInterleaved(size_t num, const char *const *inputs, size_t limit,
+                          uint32_t configuration, char *const *solutions, size_t *num_solutions,
+                          size_t *num_guesses) {
+        if (interleaved_.size() < num) interleaved_.resize(num);
+        size_t num_running = 0;
+        for (size_t i = 0; i < num; i++) {
+            InterleavedPuzzle &puzzle = interleaved_[i];
+            num_solutions[i] = 0;
+            num_guesses[i] = 0;
+            puzzle.outcome = kWaveConflict;
+            puzzle.propagation.wave = FastBitset<kNumLiterals>();
+            puzzle.propagation.deferred_clauses.clear();
+            if (configuration & 8u) {
+                Prepass prepass;
+                PrepassOutcome outcome = prepass.Run(inputs[i]);
+                if (outcome != kPrepassOpen) {
+                    num_solutions[i] = prepass.Settle(outcome, solutions[i], &num_guesses[i]);
+                    continue;
+                }
+                CollectCandidates(prepass, &puzzle.propagation.wave);
+            } else {
+                CollectGivens(inputs[i], inputs[i][kNumCells] >= '.', &puzzle.propagation.wave);
+            }
+            puzzle.state = initial_state_;
+            puzzle.outcome = kWaveNext;
+            PrefetchWave(puzzle.propagation);
+            num_running++;
+        }
+        while (num_running > 0) {
+            for (size_t i = 0; i < num; i++) {
+                InterleavedPuzzle &puzzle = interleaved_[i];
+                if (puzzle.outcome != kWaveNext) continue;
+                puzzle.outcome = AssertWave(&puzzle.propagation, &puzzle.state);
+                if (puzzle.outcome == kWaveNext) {
+                    PrefetchWave(puzzle.propagation);
+                } else {
+                    num_running--;
+                }
+            }
+        }
+        for (size_t i = 0; i < num; i++) {
+            InterleavedPuzzle &puzzle = interleaved_[i];
+            if (puzzle.outcome != kWaveFixpoint) continue;
+            FinishPropagation(puzzle.propagation, &puzzle.state);
+            BeginSearch(limit, configuration);
+            num_solutions[i] = Solve(configuration, &puzzle.state, solutions[i], &num_guesses[i]);
+        }
+    }
 
-        for (int i = 0; i < 81; i++) {
-            int box = i / 27 * 3 + (i % 9) / 3;
-            int elm = ((i / 9) % 3) * 4 + (i % 3);
-            for (int val = 0; val < 9; val++) {
-                if (result_.asserted[Literal(box, elm, val)]) {
-                    solution[i] = char('1' + val);
+    size_t Solve(uint32_t configuration, State *state, char *solution, size_t *num_guesses) {
+        Search(configuration, state);
+        for (int i = 0; i < kNumCells; i++) {
+            for (int val = 0; val < kNumValues; val++) {
+                if (result_.asserted[CellLiteral(i, val)]) {
+                    solution[i] = kValueSymbols[val];
                 }
             }
         }
@@ -100,10 +100,6 @@ struct SolverDpllTriadScc {
     vector<ClauseId> positive_cell_clauses_{};
     State initial_state_{};
 
-    // Heuristics
-    bool scc_heuristic_ = true;
-    bool scc_inference_ = true;
-
     // Limits
     size_t limit_ = 1;
 
@@ -322,8 +318,10 @@ struct SolverDpllTriadScc {
     LiteralId best_component_literal = kNoLiteral;
     int best_component_size = -1;
 
-bool SccVisit(LiteralId literal, State *state) {
-        if (scc_inference_) {
+    // Heuristics are template parameters so each configuration gets its own search loops
+    template<bool scc_inference>
+    bool SccVisit(LiteralId literal, State *state) {
+        if (scc_inference) {
             LiteralId common_ancestor = kNoLiteral;
             for (auto ancestor : stack_p) {
                 if (preorder_index[ancestor] <= preorder_index[Not(literal)]) {
@@ -356,10 +354,10 @@ bool SccVisit(LiteralId literal, State *state) {
                 // binary clauses that have no effect on inference.
                 continue;
             } else if (preorder_index[implication] == -1) {
-                if (!SccVisit(implication, state)) {
+                if (!SccVisit<scc_inference>(implication, state)) {
                     return false; // back out. we are in an inconsistent state.
                 }
-                if (scc_inference_ && state->asserted.pos_or_neg(literal)) {
+                if (scc_inference && state->asserted.pos_or_neg(literal)) {
                     // visiting an implication and its consequences may have resulted in the
                     // current literal's assertion or negation. either way we can stop.
                     break;
@@ -396,6 +394,7 @@ bool SccVisit(LiteralId literal, State *state) {
         return true;
     }
 
+    template<bool scc_inference>
     bool FindStronglyConnectedComponents(State *state) {
         preorder_counter = 0;
         preorder_index.fill(-1);
@@ -409,7 +408,7 @@ bool SccVisit(LiteralId literal, State *state) {
         for (uint16_t literal = 0; literal < kNumLiterals; literal += 2) {
             if (preorder_index[literal] == -1 && ValidLiteral(literal) &&
                 !state->asserted.pos_or_neg(literal)) {
-                if (!SccVisit(literal, state)) {
+                if (!SccVisit<scc_inference>(literal, state)) {
                     return false;
                 }
             }
@@ -465,8 +464,6 @@ bool SccVisit(LiteralId literal, State *state) {
         // Copy initial state 
         s->initial_state_            = initial_state_;
 
-        s->scc_heuristic_            = scc_heuristic_;
-        s->scc_inference_            = scc_inference_;
         s->limit_                    = limit_;
 
         s->shared_solutions_.store(0, std::memory_order_relaxed);
@@ -480,6 +477,7 @@ bool SccVisit(LiteralId literal, State *state) {
         return s;
     }
 
+    template<bool scc_inference, bool scc_heuristic>
     SearchStats BranchOnLiteral(
             LiteralId literal,
             State* state,
@@ -505,7 +503,7 @@ bool SccVisit(LiteralId literal, State *state) {
             [ls = std::move(left_solver), left, depth, limit_remaining, literal]() mutable -> ParallelOutcome {
                 ParallelOutcome po{};
                 if (ls->Assert(literal, &left)) {
-                    po.stats = ls->CountSolutionsConsistentWithPartialAssignment(
+                    po.stats = ls->CountSolutionsConsistentWithPartialAssignment<scc_inference, scc_heuristic>(
                         &left, depth + 1, false, limit_remaining);
                     if (po.stats.solutions > 0 &&
                         ls->wrote_first_solution_.load(std::memory_order_relaxed)) {
@@ -520,7 +518,7 @@ bool SccVisit(LiteralId literal, State *state) {
         SearchStats right_stats{};
         State right = *state;
         if (Assert(Not(literal), &right)) {
-            right_stats = CountSolutionsConsistentWithPartialAssignment(
+            right_stats = CountSolutionsConsistentWithPartialAssignment<scc_inference, scc_heuristic>(
                 &right, depth + 1, false, limit_remaining);
         }
 
@@ -544,7 +542,7 @@ bool SccVisit(LiteralId literal, State *state) {
 
         State left = *state; // copy State (bitset, vector, counts)
         if (Assert(literal, &left)) {
-            auto got = CountSolutionsConsistentWithPartialAssignment(
+            auto got = CountSolutionsConsistentWithPartialAssignment<scc_inference, scc_heuristic>(
                 &left, depth + 1, false, limit_remaining);
             out.solutions += got.solutions;
             out.guesses   += got.guesses;
@@ -553,7 +551,7 @@ bool SccVisit(LiteralId literal, State *state) {
 
         // Right branch 
         if (Assert(Not(literal), state)) {
-            auto got = CountSolutionsConsistentWithPartialAssignment(
+            auto got = CountSolutionsConsistentWithPartialAssignment<scc_inference, scc_heuristic>(
                 state, depth + 1, false,
                 limit_remaining - out.solutions);
             out.solutions += got.solutions;
@@ -563,16 +561,17 @@ bool SccVisit(LiteralId literal, State *state) {
         return out;
     }
 
+    template<bool scc_inference, bool scc_heuristic>
     SearchStats CountSolutionsConsistentWithPartialAssignment(
         State *state, int depth, bool parallel_first_split, size_t limit_remaining) {
 
         SearchStats out{};
         if (limit_remaining == 0 || stop_.load(std::memory_order_relaxed)) return out;
 
-        if (scc_heuristic_ || scc_inference_) {
+        if (scc_heuristic || scc_inference) {
             while (state->num_asserted < kAllAsserted) {
                 auto prev_asserted = state->num_asserted;
-                if (!FindStronglyConnectedComponents(state)) return out; // inconsistent -> 0 solutions
+                if (!FindStronglyConnectedComponents<scc_inference>(state)) return out; // inconsistent -> 0 solutions
                 if (prev_asserted == state->num_asserted) break;
             }
         }
@@ -592,7 +591,7 @@ bool SccVisit(LiteralId literal, State *state) {
         }
 
         LiteralId branch_literal =
-            (scc_heuristic_ && best_component_literal != kNoLiteral)
+            (scc_heuristic && best_component_literal != kNoLiteral)
                 ? best_component_literal
                 : ChooseLiteralToBranchByClause(state);
 
@@ -605,7 +604,7 @@ bool SccVisit(LiteralId literal, State *state) {
         }
 #endif
 
-        auto got = BranchOnLiteral(branch_literal, state, depth, parallel_first_split, limit_remaining);
+        auto got = BranchOnLiteral<scc_inference, scc_heuristic>(branch_literal, state, depth, parallel_first_split, limit_remaining);
         if (got.solutions >= limit_remaining) {
             stop_.store(true, std::memory_order_relaxed);
         }
@@ -637,11 +636,27 @@ bool SccVisit(LiteralId literal, State *state) {
     // entry
     ///////////////////////////////////////////////
 
+    // Dispatch on configuration bits 0 (SCC inference) and 1 (SCC heuristic)
+    SearchStats Search(uint32_t configuration, State *state, bool parallel_first_split) {
+        switch (configuration & 3u) {
+            case 0:
+                return CountSolutionsConsistentWithPartialAssignment<false, false>(
+                    state, 0, parallel_first_split, limit_);
+            case 1:
+                return CountSolutionsConsistentWithPartialAssignment<true, false>(
+                    state, 0, parallel_first_split, limit_);
+            case 2:
+                return CountSolutionsConsistentWithPartialAssignment<false, true>(
+                    state, 0, parallel_first_split, limit_);
+            default:
+                return CountSolutionsConsistentWithPartialAssignment<true, true>(
+                    state, 0, parallel_first_split, limit_);
+        }
+    }
+
     size_t SolveSudoku(const char *input, size_t limit, uint32_t configuration,
                        char *solution, size_t *num_guesses) {
         limit_ = limit;
-        scc_inference_ = (configuration & 1u) > 0;
-        scc_heuristic_ = (configuration & 2u) > 0;
         bool pencilmark = input[81] >= '.';
         num_solutions_ = 0;
         num_guesses_   = 0;
@@ -656,10 +671,8 @@ bool SccVisit(LiteralId literal, State *state) {
         stop_.store(false, std::memory_order_relaxed);
         wrote_first_solution_.store(false, std::memory_order_relaxed);
 
-        auto stats = CountSolutionsConsistentWithPartialAssignment(
-            &state, /*depth*/0,
-            /*parallel_first_split*/ g_drake_cfg.parallel_depth1,
-            /*limit_remaining*/ limit_);
+        auto stats = Search(configuration, &state,
+            /*parallel_first_split*/ g_drake_cfg.parallel_depth1);
 
         num_solutions_ = stats.solutions;
         num_guesses_   = stats.guesses;
@@ -0,0 +1,26 @@
+// Vectorized variant of the SoA solver: the core with the SimdKernels of triad_scc_simd.hpp.
+
+#include "triad_scc_core.hpp"
+#include "triad_scc_simd.hpp"
+#include "adjacency.hpp"
+
+namespace {
+
+using Solver = SolverDpllTriadScc<AdjCSR<kNumLiterals>, SimdKernels>;
+
+} // namespace
+
+// with the singles pre-pass (flags bit 3), the solver is only set up for the puzzles the
+// pre-pass leaves open.
+extern "C" size_t DrakeSolverTriadScc_SIMD(
+    const char* input, size_t limit, uint32_t flags, char* solution, size_t* num_guesses) {
+  if (flags & 8u) {
+    Solver::Prepass prepass;
+    PrepassOutcome outcome = prepass.Run(input);
+    if (outcome != kPrepassOpen) return prepass.Settle(outcome, solution, num_guesses);
+    Solver solver;
+    return solver.SolveSudoku(prepass, limit, flags, solution, num_guesses);
+  }
+  Solver solver;
+  return solver.SolveSudoku(input, limit, flags, solution, num_guesses);
+}
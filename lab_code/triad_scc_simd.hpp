@@ -0,0 +1,71 @@
+#pragma once
+
+// Vectorized scans for the SoA solver core. Same search, same guesses; the whole-state scans
+// run on tdoku's SIMD vector types instead of one literal or clause at a time:
+//  - choosing a clause to branch on is a minpos reduction over the 81 cell clause counters,
+//    which the core numbers contiguously at the front of clause_free_literals.
+//  - SCC root selection computes the undecided positive literals a word at a time from the
+//    asserted bitset and only visits those, instead of testing all 1296 positive literals.
+// Clause counter updates stay scalar: the three or four clauses touched by a literal are
+// scattered across boxes and bands, so there's nothing contiguous to load. batching them per
+// box in AssertWave would also change the order clauses reach their trigger point, and with
+// it the implications the SCC pass walks, so the search would no longer match the scalar
+// core's. run_microbench times both scans each way (min_free_cell_*, undecided_positive_*).
+//
+// On non-x86 targets simd_vectors.h provides its portable vector-extension backend.
+
+#include "triad_scc_core.hpp"
+#include "../third_party/tdoku/src/bitutil.h"
+#include "../third_party/tdoku/src/simd_vectors.h"
+
+namespace {
+
+// these kernels are written for the 9x9 board's layout.
+struct SimdKernels {
+    template<int num_cells>
+    static int MinFreeCell(const uint16_t *cell_free_literals) {
+        static_assert(num_cells == kNumCells, "SimdKernels only supports 9x9 boards");
+        // 10 full vectors of 8 counters, then cell 80 on its own.
+        uint32_t best = 0xffffffffu;
+        int which_cell = 0;
+        for (int cell = 0; cell < kNumCells - 1; cell += 8) {
+            const uint16_t *c = &cell_free_literals[cell];
+            Bitvec08x16 counters{c[0], c[1], c[2], c[3], c[4], c[5], c[6], c[7]};
+            uint32_t min_pos = counters.MinPosGreaterThanOrEqual(0);
+            if ((min_pos & 0xffffu) < (best & 0xffffu)) {
+                best = min_pos;
+                which_cell = cell + (int) (min_pos >> 16u);
+            }
+        }
+        if (cell_free_literals[kNumCells - 1] < (best & 0xffffu)) {
+            which_cell = kNumCells - 1;
+        }
+        return which_cell;
+    }
+
+    template<class Visit>
+    static bool ForEachUndecidedPositive(const FastBitset<kNumLiterals> &asserted, Visit visit) {
+        constexpr int kNumWords = FastBitset<kNumLiterals>::kNumWords;
+        // even (positive) bits, excluding the filler literals at 30 and 62 of each word.
+        constexpr uint64_t kValidPositive = 0x1555555515555555ul;
+        const uint64_t *words = asserted.words();
+
+        // a positive literal is undecided when neither it nor its negation (the next bit up) is
+        // asserted. this loop is written to vectorize across words.
+        alignas(32) uint64_t undecided[kNumWords];
+        for (int i = 0; i < kNumWords; i++) {
+            undecided[i] = ~(words[i] | (words[i] >> 1u)) & kValidPositive;
+        }
+        // the last word is only half used.
+        undecided[kNumWords - 1] &= (1ul << (kNumLiterals % 64)) - 1;
+
+        for (int i = 0; i < kNumWords; i++) {
+            for (uint64_t bits = undecided[i]; bits; bits &= bits - 1) {
+                if (!visit((LiteralId) (i * 64 + __builtin_ctzll(bits)))) return false;
+            }
+        }
+        return true;
+    }
+};
+
+} // namespace
@@ -1,11 +1,47 @@
 #include "triad_scc_core.hpp"
 #include "adjacency.hpp"
 
+#include <memory>
+
 // Use the compact CSR adjacency
 using Solver = SolverDpllTriadScc<AdjCSR<kNumLiterals>>;
 
+// with the singles pre-pass (flags bit 3), the solver is only set up for the puzzles the
+// pre-pass leaves open.
 extern "C" size_t DrakeSolverTriadScc_SOA(
     const char* input, size_t limit, uint32_t flags, char* solution, size_t* num_guesses) {
+  if (flags & 8u) {
+    Solver::Prepass prepass;
+    PrepassOutcome outcome = prepass.Run(input);
+    if (outcome != kPrepassOpen) return prepass.Settle(outcome, solution, num_guesses);
+    Solver solver;
+    return solver.SolveSudoku(prepass, limit, flags, solution, num_guesses);
+  }
   Solver solver;
   return solver.SolveSudoku(input, limit, flags, solution, num_guesses);
 }
+
+namespace {
+
+// larger boards. their solvers take far longer to set up than the 9x9 one and are too big
+// for the stack, so each thread keeps one on the heap.
+template<int box_dim>
+size_t SolveLargeBoard(const char* input, size_t limit, uint32_t flags, char* solution,
+                       size_t* num_guesses) {
+  using Geometry = BoardGeometry<box_dim>;
+  using LargeSolver = SolverDpllTriadScc<AdjCSR<Geometry::kNumLiterals>, ScalarKernels, Geometry>;
+  static thread_local std::unique_ptr<LargeSolver> solver(new LargeSolver());
+  return solver->SolveSudoku(input, limit, flags, solution, num_guesses);
+}
+
+}  // namespace
+
+extern "C" size_t DrakeSolverTriadScc16(
+    const char* input, size_t limit, uint32_t flags, char* solution, size_t* num_guesses) {
+  return SolveLargeBoard<4>(input, limit, flags, solution, num_guesses);
+}
+
+extern "C" size_t DrakeSolverTriadScc25(
+    const char* input, size_t limit, uint32_t flags, char* solution, size_t* num_guesses) {
+  return SolveLargeBoard<5>(input, limit, flags, solution, num_guesses);
+}
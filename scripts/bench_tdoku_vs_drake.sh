@@ -41,7 +41,9 @@ W=2      # warmup seconds
 T=2      # test seconds
 R=0      # do not permute (stable, reproducible ordering)
 
-SOLVERS="tdoku/triad_scc,drake/triad_scc_soa,drake/triad_scc_parallel_d1"
+# triad_scc_soa_probe adds failed-literal probing (configuration bit 2); compare its
+# guesses_per_puzzle and usec_per_puzzle with triad_scc_soa on the 17-clue set.
+SOLVERS="tdoku/triad_scc,drake/triad_scc_soa,drake/triad_scc_soa_probe,drake/triad_scc_parallel_d1,drake/bitboard"
 
 # --- unbiased set ---
 "$RUN" "$DATA_DIR/puzzles1_unbiased" -s "$SOLVERS" -n "$N" -w "$W" -t "$T" -r "$R" -c 1 >> "$OUT"
@@ -49,4 +51,11 @@ SOLVERS="tdoku/triad_scc,drake/triad_scc_soa,drake/triad_scc_parallel_d1"
 # --- 17-clue hard set ---
 "$RUN" "$DATA_DIR/puzzles2_17_clue" -s "$SOLVERS" -n "$N" -w "$W" -t "$T" -r "$R" -c 1 >> "$OUT"
 
+# --- solution counting: 17-clue puzzles with one clue blanked out (-u), counted up to -l ---
+# drake/lib counts on one thread, drake/lib_count splits each count over every core; compare
+# their usec_per_puzzle. guesses_per_puzzle differ slightly (the split's own branches).
+COUNT_SOLVERS="drake/lib,drake/lib_count"
+"$RUN" "$DATA_DIR/puzzles2_17_clue" -s "$COUNT_SOLVERS" -n 200 -w "$W" -t "$T" -r "$R" -c 1 \
+    -u 1 -l 10000000 >> "$OUT"
+
 echo "Wrote $OUT"
@@ -27,6 +27,30 @@ size_t TdokuEnumerate(const char *puzzle,
 bool TdokuConstrain(bool pencilmark, char *puzzle);
 
 bool TdokuMinimize(bool pencilmark, bool monotonic, char *puzzle);
+
+void TdokuRandomSeed(uint64_t seed);
+
+size_t TdokuMinimizeBatch(bool pencilmark,
+                          bool monotonic,
+                          size_t num_puzzles,
+                          char *puzzles,
+                          bool *results,
+                          int num_threads,
+                          uint64_t seed);
+
+typedef size_t (*TdokuSolverFn)(const char *input,
+                                size_t limit,
+                                uint32_t configuration,
+                                char *solution,
+                                size_t *num_guesses);
+
+size_t TdokuNumIsaVariants(void);
+
+const char *TdokuIsaVariantName(size_t which);
+
+TdokuSolverFn TdokuIsaVariantSolver(size_t which);
+
+const char *TdokuSelectedIsa(void);
 #ifdef __cplusplus
 }
 #endif
@@ -111,4 +135,69 @@ static inline bool Minimize(bool pencilmark, bool monotonic, char *puzzle) {
     return TdokuMinimize(pencilmark, monotonic, puzzle);
 }
 
+/**
+ * Minimizes many vanilla or pencilmark puzzles as Minimize does, in parallel. Puzzle i is
+ * minimized exactly as Minimize would after RandomSeed(SplitMix64(seed + i)) (see src/util.h),
+ * so the output depends on seed but not on num_threads. The calling thread's generator is left
+ * seeded for the last puzzle it minimized.
+ * @param pencilmark
+ *       A boolean indicating whether to minimize pencilmark sudokus (vs. vanilla ones)
+ * @param monotonic
+ *       As for Minimize.
+ * @param num_puzzles
+ *       The number of puzzles to minimize.
+ * @param puzzles
+ *       num_puzzles puzzles of 81 or 729 characters each (for vanilla vs. pencilmark), stored
+ *       back to back with no separators, which are minimized in place.
+ * @param results
+ *       Either null or an array of num_puzzles booleans to receive Minimize's result per puzzle.
+ * @param num_threads
+ *       The number of threads to use, including the caller's. Zero or less means one per core.
+ * @param seed
+ *       The seed from which each puzzle's random order of clue removal is derived.
+ * @return
+ *       The number of puzzles for which Minimize would have returned true.
+ */
+static inline size_t MinimizeBatch(bool pencilmark, bool monotonic, size_t num_puzzles,
+                                   char *puzzles, bool *results, int num_threads, uint64_t seed) {
+    return TdokuMinimizeBatch(pencilmark, monotonic, num_puzzles, puzzles, results, num_threads,
+                              seed);
+}
+
+/**
+ * Seeds the random choices made by Constrain and Minimize. Each thread has its own generator
+ * (seeded from std::random_device until this is called), so this affects only the calling thread.
+ * @param seed
+ *       The new seed.
+ */
+static inline void RandomSeed(uint64_t seed) {
+    TdokuRandomSeed(seed);
+}
+
+/**
+ * Lists the instruction set builds of the solver in this library. A library configured with
+ * cmake -DDISPATCH=ON contains baseline x86-64, SSE4.2, AVX2 and AVX512-BITALG builds, and
+ * SolveSudoku and Enumerate use the best one the host supports, or the one named by the TDOKU_ISA
+ * environment variable. Otherwise there is exactly one build.
+ * @param which
+ *       An index in 0..TdokuNumIsaVariants()-1.
+ * @return
+ *       The build's name, e.g., "avx2", or null if the index is out of range.
+ */
+static inline const char *IsaVariantName(size_t which) {
+    return TdokuIsaVariantName(which);
+}
+
+/**
+ * Returns the solver entry point for a specific instruction set build, for benchmarking and
+ * testing. The function has the same contract as SolveSudoku.
+ * @param which
+ *       An index in 0..TdokuNumIsaVariants()-1.
+ * @return
+ *       The build's entry point, or null if the host can not run it or the index is out of range.
+ */
+static inline TdokuSolverFn IsaVariantSolver(size_t which) {
+    return TdokuIsaVariantSolver(which);
+}
+
 #endif //TDOKU_H
@@ -50,8 +50,33 @@ extern "C" {
     SolverFn TdokuSolverDpllTriadScc;
     SolverFn TdokuSolverDpllTriadSimd;
 
+    // instruction set builds of TdokuSolverDpllTriadSimd (see src/solver_dispatch.cc).
+    size_t TdokuNumIsaVariants();
+    const char *TdokuIsaVariantName(size_t which);
+    SolverFn *TdokuIsaVariantSolver(size_t which);
+    const char *TdokuSelectedIsa();
+
     SolverFn DrakeSolverTriadScc_SOA;
     SolverFn DrakeSolverTriadScc_ParallelD1;
+    SolverFn DrakeSolverTriadScc_SIMD;
+    SolverFn DrakeSolverTriadCdcl;
+    SolverFn DrakeSolverBitboard;
+    // the drake library's entry points (lab_code/include/drake.h), with a solver per thread.
+    SolverFn DrakeSolveSudoku;
+    size_t DrakeCountSolutions(const char *input, size_t limit, uint32_t configuration,
+                               size_t *num_guesses, int num_threads);
+    // the library's internal interleaved batch (lab_code/drake.cc), not exported by the shared
+    // library. DrakeResult comes from drake.h.
+    size_t DrakeSolveBatchInterleaved(bool pencilmark, size_t num_puzzles, const char *puzzles,
+                                      size_t limit, uint32_t configuration,
+                                      struct DrakeResult *results, int num_threads,
+                                      int interleave);
+    // the SoA solver on 16x16 and 25x25 boards (boxes of 4x4 and 5x5 cells). input is one
+    // symbol per cell, '1'..'9' then 'A'..'P', or '.' for an empty cell: 256 or 625
+    // characters, or 4096 or 15625 for pencilmark input. solution receives 256 or 625
+    // symbols. these take boards of one size only, so they aren't in GetAllSolvers.
+    SolverFn DrakeSolverTriadScc16;
+    SolverFn DrakeSolverTriadScc25;
 
     SolverFn OtherSolverGss;
     SolverFn OtherSolverZ3;
@@ -86,14 +111,28 @@ private:
     bool returns_count_;
     bool returns_full_count_;
     bool returns_guess_count_;
+    bool takes_thread_count_;
+    bool thread_safe_;
 
 public:
+    // features: 1 returns a solution, 2 a count, 4 a full count, 8 a guess count, 16 takes a
+    // thread count (see TakesThreadCount), 32 may run on several threads at once.
     Solver(SolverFn *solver_fn, uint32_t configuration, std::string name, std::string desc, uint32_t features)
             : solve_(solver_fn), configuration_(configuration), name_(std::move(name)), desc_(std::move(desc)),
               returns_solution_((features & 1u) > 0),
               returns_count_((features & 2u) > 0),
               returns_full_count_((features & 4u) > 0),
-              returns_guess_count_((features & 8u) > 0) {}
+              returns_guess_count_((features & 8u) > 0),
+              takes_thread_count_((features & 16u) > 0),
+              thread_safe_((features & 32u) > 0) {}
+
+    // a copy with another configuration and name, e.g. for run_benchmark's sweeps.
+    Solver Reconfigured(uint32_t configuration, std::string name) const {
+        Solver solver = *this;
+        solver.configuration_ = configuration;
+        solver.name_ = std::move(name);
+        return solver;
+    }
 
     inline size_t Solve(const char *input, size_t limit,
                         char *solution, size_t *num_guesses) const {
@@ -104,6 +143,10 @@ public:
         return name_;
     }
 
+    inline uint32_t Configuration() const {
+        return configuration_;
+    }
+
     /*
      * Solver descriptions:
      * The first character indicates the solver's primary representation:
@@ -145,8 +188,27 @@ public:
     inline bool ReturnsGuessCount() const {
         return returns_guess_count_;
     }
+
+    // whether the solver takes a thread count in configuration bits 16 and up.
+    inline bool TakesThreadCount() const {
+        return takes_thread_count_;
+    }
+
+    // whether calls may run on several threads at once: the solver keeps its state per call or
+    // per thread. many of the other solvers, and tdoku/triad_scc, keep it in statics.
+    inline bool ThreadSafe() const {
+        return thread_safe_;
+    }
 };
 
+// DrakeCountSolutions as a SolverFn, on the number of threads in configuration bits 16 and up
+// (zero for every core). it counts only, with no solution returned.
+size_t DrakeCountSolutionsThreaded(const char *input, size_t limit, uint32_t configuration,
+                                   char * /*solution*/, size_t *num_guesses) {
+    return DrakeCountSolutions(input, limit, configuration & 0xffffu, num_guesses,
+                               (int) (configuration >> 16u));
+}
+
 std::vector<Solver> GetAllSolvers() {
     std::vector<Solver> solvers;
     // @formatter:off
@@ -219,6 +281,9 @@ std::vector<Solver> GetAllSolvers() {
 #ifdef RUST_SUDOKU
     solvers.emplace_back(Solver(OtherSolverRustSudoku,        0, "rust_sudoku",               "B/shr.../m.", 14));
 #endif
+    // tdoku's own SIMD solver, for comparison with the vectorized lab solver.
+    solvers.emplace_back(Solver(TdokuSolverDpllTriadSimd,        0,
+        "tdoku",                       "T/shrc++/m+", 47));
     // Stock tdoku SCC solver, registered unconditionally as the benchmark reference.
     // (Previously only available behind the TDEV build flag, so the bench script's
     // "tdoku/triad_scc" target silently resolved to nothing.)
@@ -228,12 +293,56 @@ std::vector<Solver> GetAllSolvers() {
     // (bit 1), the intended mode that makes these "triad_scc" solvers actually use
     // SCC-driven branching. With SCC on their guess counts match tdoku's exactly.
     solvers.emplace_back(Solver(DrakeSolverTriadScc_SOA,         3,
-        "drake/triad_scc_soa",         "S/shrc++/m+", 15));
+        "drake/triad_scc_soa",         "S/shrc++/m+", 47));
     solvers.emplace_back(Solver(DrakeSolverTriadScc_ParallelD1,  3,
-        "drake/triad_scc_parallel_d1", "S/shrc++/m+", 15));
+        "drake/triad_scc_parallel_d1", "S/shrc++/m+", 47));
+    // Vectorized SoA variant.
+    solvers.emplace_back(Solver(DrakeSolverTriadScc_SIMD,        3,
+        "drake/triad_scc_simd",        "S/shrc++/m+", 47));
+    // SoA with failed-literal probing (bit 2) before each guess. Fewer guesses on hard
+    // puzzles, at the cost of the probes themselves.
+    solvers.emplace_back(Solver(DrakeSolverTriadScc_SOA,         7,
+        "drake/triad_scc_soa_probe",   "S/shrc++/m+", 47));
+    // SoA with the singles pre-pass (bit 3). The solver is set up per call, so this mostly
+    // measures the setup the pre-pass skips.
+    solvers.emplace_back(Solver(DrakeSolverTriadScc_SOA,         11,
+        "drake/soa_singles",           "S/shrc++/m+", 47));
+    // Clause learning over the same encoding, for zero-solution, many-solution and heavily
+    // constrained pencilmark inputs where DPLL keeps rediscovering the same conflicts.
+    solvers.emplace_back(Solver(DrakeSolverTriadCdcl,            0,
+        "drake/triad_cdcl",            "S/shrc+./.+", 47));
+    // Nine digit bitboards in 128-bit words, with singles and table-driven locked candidates,
+    // branching on a bivalue or fewest-candidate cell. A representation baseline for the above.
+    solvers.emplace_back(Solver(DrakeSolverBitboard,             0,
+        "drake/bitboard",              "D/shrc+./m.", 47));
+    // The vectorized SoA solver as the drake library exposes it. Each thread reuses one solver
+    // instead of setting up the clauses and implication lists again for every puzzle.
+    solvers.emplace_back(Solver(DrakeSolveSudoku,                3,
+        "drake/lib",                   "S/shrc++/m+", 47));
+    // With the singles pre-pass (bit 3), which settles most easy puzzles on per-cell candidate
+    // masks before the clause state is even copied.
+    solvers.emplace_back(Solver(DrakeSolveSudoku,                11,
+        "drake/lib_singles",           "S/shrc++/m+", 47));
+    // Counting split into cubes across all cores. Only worth it for many-solution inputs: run
+    // with a large -l (e.g., with -u for under-constrained puzzles) and compare with drake/lib.
+    // Feature 16: run_benchmark -q sweeps its thread count.
+    solvers.emplace_back(Solver(DrakeCountSolutionsThreaded,     3,
+        "drake/lib_count",             "S/shrc++/m+", 62));
     // @formatter:on
     return solvers;
 }
+
+// one "tdoku/<isa>" solver for each instruction set build of tdoku that this host can run.
+std::vector<Solver> GetIsaVariantSolvers() {
+    std::vector<Solver> solvers;
+    for (size_t i = 0; i < TdokuNumIsaVariants(); i++) {
+        SolverFn *solve = TdokuIsaVariantSolver(i);
+        if (solve == nullptr) continue;
+        solvers.emplace_back(Solver(solve, 0, std::string("tdoku/") + TdokuIsaVariantName(i),
+                                    "T/shrc++/m+", 47));
+    }
+    return solvers;
+}
 #endif // __cplusplus
 
 #endif // TDOKU_SOLVER_H
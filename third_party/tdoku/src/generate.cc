@@ -3,19 +3,26 @@
 #include "util.h"
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <condition_variable>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <limits>
+#include <mutex>
 #include <random>
-#include <set>
+#include <thread>
 #include <tuple>
 #include <vector>
 
+#include <sys/resource.h>
+#include <unistd.h>
+
 using namespace std;
 
 extern "C" {
@@ -44,15 +51,306 @@ struct Options {
     bool minimize = true;
     bool pencilmark = true;
     int solver = 1;
+    // candidates are evaluated in batches on this many threads, then merged into the pool in
+    // order. the pool is only read during a batch, so results depend on the batch size (and
+    // random_seed, if given) but not on the number of threads. the default batch is fixed for
+    // that reason, and big enough to keep a few dozen threads busy.
+    int num_threads = 1;
+    int batch_size = 32;
+    // if nonzero, makes generation reproducible for a given batch size.
+    uint64_t random_seed = 0;
+    // if nonzero, a bloom filter of 2^filter_bits bits remembers every candidate merged so far,
+    // and candidates it has (probably) seen are dropped before evaluation.
+    int filter_bits = 0;
+    // if nonzero, reports progress to stderr about this often.
+    double report_seconds = 0.0;
+};
+
+// Runs fn(worker, i) for i in [0, n) on a fixed set of threads, returning when all are done.
+// With one thread everything runs on the caller's.
+class WorkerPool {
+public:
+    explicit WorkerPool(int num_threads) {
+        for (int worker = 1; worker < num_threads; worker++) {
+            threads_.emplace_back([this, worker] { Work(worker); });
+        }
+    }
+
+    ~WorkerPool() {
+        {
+            lock_guard<mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        start_.notify_all();
+        for (thread &t : threads_) t.join();
+    }
+
+    void Run(size_t n, const function<void(int, size_t)> &fn) {
+        unique_lock<mutex> lock(mutex_);
+        fn_ = &fn;
+        n_ = n;
+        next_ = 0;
+        unfinished_ = n;
+        generation_++;
+        start_.notify_all();
+        RunItems(0, lock);
+        done_.wait(lock, [this] { return unfinished_ == 0; });
+        fn_ = nullptr;
+    }
+
+private:
+    vector<thread> threads_;
+    mutex mutex_;
+    condition_variable start_;
+    condition_variable done_;
+    const function<void(int, size_t)> *fn_ = nullptr;
+    size_t n_ = 0;
+    size_t next_ = 0;
+    size_t unfinished_ = 0;
+    uint64_t generation_ = 0;
+    bool stopping_ = false;
+
+    // claims and runs items until there are none left. called and returns with lock held.
+    void RunItems(int worker, unique_lock<mutex> &lock) {
+        while (next_ < n_) {
+            size_t i = next_++;
+            lock.unlock();
+            (*fn_)(worker, i);
+            lock.lock();
+            if (--unfinished_ == 0) done_.notify_all();
+        }
+    }
+
+    void Work(int worker) {
+        uint64_t seen_generation = 0;
+        unique_lock<mutex> lock(mutex_);
+        while (true) {
+            start_.wait(lock, [&] { return stopping_ || generation_ != seen_generation; });
+            if (stopping_) return;
+            seen_generation = generation_;
+            RunItems(worker, lock);
+        }
+    }
+};
+
+// puzzles and patterns packed to a fixed width: a bit per pencilmark candidate (729 bits in 12
+// words) or a nibble per vanilla cell (81 nibbles in 6 words), zero-padded. positions fill
+// words from the most significant bit down and '.' packs below any digit, so packed keys
+// order the way their strings do.
+const int kMaxKeyWords = 12;
+
+struct PatternKey {
+    uint64_t words[kMaxKeyWords] = {};
+};
+
+int KeyWords(bool pencilmark) {
+    return pencilmark ? 12 : 6;
+}
+
+PatternKey PackPattern(const char *puzzle, bool pencilmark) {
+    PatternKey key;
+    if (pencilmark) {
+        // a pencilmark candidate at position i is either '.' or '1' + i % 9.
+        for (int i = 0; i < 729; i++) {
+            if (puzzle[i] != '.') key.words[i / 64] |= 1ull << (63u - i % 64u);
+        }
+    } else {
+        for (int i = 0; i < 81; i++) {
+            uint64_t nibble = puzzle[i] == '.' ? 0 : (uint64_t) (puzzle[i] - '0') & 0xfu;
+            key.words[i / 16] |= nibble << (60u - 4 * (i % 16u));
+        }
+    }
+    return key;
+}
+
+void UnpackPattern(const uint64_t *words, bool pencilmark, char *puzzle) {
+    if (pencilmark) {
+        for (int i = 0; i < 729; i++) {
+            bool set = (words[i / 64] >> (63u - i % 64u)) & 1u;
+            puzzle[i] = set ? (char) ('1' + i % 9) : '.';
+        }
+    } else {
+        for (int i = 0; i < 81; i++) {
+            uint64_t nibble = (words[i / 16] >> (60u - 4 * (i % 16u))) & 0xfu;
+            puzzle[i] = nibble == 0 ? '.' : (char) ('0' + nibble);
+        }
+    }
+}
+
+uint64_t HashKey(const uint64_t *words, int num_words) {
+    uint64_t hash = 0;
+    for (int i = 0; i < num_words; i++) hash = SplitMix64(hash ^ words[i]);
+    return hash;
+}
+
+// an open-addressing set of the distinct keys among slots of a packed key array (num_words
+// per slot), holding 4-byte slot numbers and probing linearly. erasing shifts the rest of the
+// probe run back rather than leaving tombstones, so lookups stay short however long the
+// generator runs and however many puzzles pass through the pool.
+class PatternSet {
+public:
+    PatternSet(const vector<uint64_t> &slot_keys, int num_words) :
+            slot_keys_(slot_keys), num_words_(num_words) {}
+
+    bool Contains(const uint64_t *key) const {
+        return !entries_.empty() && entries_[Find(key)] != kEmpty;
+    }
+
+    // adds the key in the given slot, unless an equal key is already present.
+    void Insert(uint32_t slot) {
+        if (2 * (size_ + 1) > entries_.size()) Grow();
+        size_t i = Find(SlotKey(slot));
+        if (entries_[i] != kEmpty) return;
+        entries_[i] = slot;
+        size_++;
+    }
+
+    void Erase(const uint64_t *key) {
+        if (entries_.empty()) return;
+        size_t i = Find(key);
+        if (entries_[i] == kEmpty) return;
+        // move back any later entry of the run whose home isn't cyclically in (i, j].
+        for (size_t j = (i + 1) & mask_; entries_[j] != kEmpty; j = (j + 1) & mask_) {
+            size_t home = Home(SlotKey(entries_[j]));
+            if (((j - home) & mask_) >= ((j - i) & mask_)) {
+                entries_[i] = entries_[j];
+                i = j;
+            }
+        }
+        entries_[i] = kEmpty;
+        size_--;
+    }
+
+private:
+    enum : uint32_t { kEmpty = UINT32_MAX };
+    const vector<uint64_t> &slot_keys_;
+    int num_words_;
+    vector<uint32_t> entries_;
+    size_t mask_ = 0;
+    size_t size_ = 0;
+
+    const uint64_t *SlotKey(uint32_t slot) const { return &slot_keys_[slot * num_words_]; }
+
+    size_t Home(const uint64_t *key) const { return HashKey(key, num_words_) & mask_; }
+
+    // the entry holding key, or the empty entry ending its probe run.
+    size_t Find(const uint64_t *key) const {
+        size_t i = Home(key);
+        for (; entries_[i] != kEmpty; i = (i + 1) & mask_) {
+            if (memcmp(SlotKey(entries_[i]), key, num_words_ * sizeof(uint64_t)) == 0) break;
+        }
+        return i;
+    }
+
+    void Grow() {
+        vector<uint32_t> entries;
+        entries.swap(entries_);
+        size_t capacity = max<size_t>(64, 2 * entries.size());
+        entries_.assign(capacity, kEmpty);
+        mask_ = capacity - 1;
+        size_ = 0;
+        for (uint32_t slot : entries) {
+            if (slot != kEmpty) Insert(slot);
+        }
+    }
+};
+
+// a bloom filter over pattern keys in a fixed 2^num_bits bits, with four probes derived from
+// the key's hash. it never forgets and never grows: false positives rise as it fills.
+class PatternFilter {
+public:
+    PatternFilter(int num_bits, int num_words) :
+            num_words_(num_words),
+            bits_(num_bits > 0 ? (size_t(1) << max(num_bits, 6)) / 64 : 0),
+            mask_(num_bits > 0 ? (size_t(1) << max(num_bits, 6)) - 1 : 0) {}
+
+    bool Enabled() const { return !bits_.empty(); }
+
+    bool MayContain(const PatternKey &key) const {
+        uint64_t hash = HashKey(key.words, num_words_);
+        for (int probe = 0; probe < 4; probe++) {
+            size_t bit = Probe(hash, probe);
+            if (!(bits_[bit / 64] & (1ull << (bit % 64)))) return false;
+        }
+        return true;
+    }
+
+    void Insert(const PatternKey &key) {
+        uint64_t hash = HashKey(key.words, num_words_);
+        for (int probe = 0; probe < 4; probe++) {
+            size_t bit = Probe(hash, probe);
+            bits_[bit / 64] |= 1ull << (bit % 64);
+        }
+    }
+
+private:
+    int num_words_;
+    vector<uint64_t> bits_;
+    size_t mask_;
+
+    size_t Probe(uint64_t hash, int probe) const {
+        return (size_t) ((hash + probe * ((hash >> 32u) | 1u)) & mask_);
+    }
+};
+
+// resident set size of this process in kilobytes: current where /proc offers it, else peak.
+size_t ResidentKilobytes() {
+    FILE *statm = fopen("/proc/self/statm", "r");
+    if (statm != nullptr) {
+        unsigned long long total_pages = 0, resident_pages = 0;
+        int num_read = fscanf(statm, "%llu %llu", &total_pages, &resident_pages);
+        fclose(statm);
+        if (num_read == 2) return (size_t) (resident_pages * (sysconf(_SC_PAGESIZE) / 1024));
+    }
+    struct rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return (size_t) usage.ru_maxrss / 1024;
+#else
+    return (size_t) usage.ru_maxrss;
+#endif
+}
+
+// a freshly generated puzzle and its evaluation, before deciding whether it joins the pool.
+struct Candidate {
+    bool valid = false;
+    bool filtered = false; // dropped unevaluated as seen before
+    PatternKey source; // the pool entry it was derived from
+    PatternKey key;
+    string puzzle;
+    int num_clues = 0;
+    double geo_mean_guesses = 0.0;
+    double loss = 0.0;
 };
 
 struct Generator {
     Options options_;
     Util util_{};
-    vector<pair<double, string>> pattern_heap{};
-    set<string> pattern_set{};
-
-    explicit Generator(const Options &options) : options_(options) {}
+    // the pool, stored contiguously: packed keys back to back in fixed-size slots and their
+    // losses, with a max-heap of slot numbers ordered by (loss, puzzle). one slot more than the
+    // pool holds the incoming puzzle while the worst is evicted.
+    int key_words_;
+    vector<uint64_t> pool_keys_{};
+    vector<double> pool_losses_{};
+    vector<uint32_t> pattern_heap{};
+    uint32_t spare_slot_ = 0;
+    // keys of the puzzles in the pool, to skip duplicates.
+    PatternSet pattern_set;
+    PatternFilter seen_filter_;
+    uint64_t num_filtered_ = 0;
+    // one per worker thread, reseeded for each candidate.
+    vector<Util> worker_utils_;
+    uint64_t base_seed_;
+    // the minisat and gurobi wrappers keep global solver state.
+    mutex other_solver_mutex_{};
+
+    explicit Generator(const Options &options) :
+            options_(options), key_words_(KeyWords(options.pencilmark)),
+            pattern_set(pool_keys_, key_words_),
+            seen_filter_(options.filter_bits, key_words_), worker_utils_(options.num_threads),
+            base_seed_(options.random_seed != 0 ? options.random_seed : random_device{}()) {
+        util_.RandomSeed(SplitMix64(base_seed_));
+    }
 
     const string kInitPencilmark =
             "123456789123456789123456789123456789123456789123456789123456789123456789123456789"
@@ -68,13 +366,43 @@ struct Generator {
     const string kInitVanilla =
             ".................................................................................";
 
+    uint64_t *SlotKey(uint32_t slot) { return &pool_keys_[slot * key_words_]; }
+
+    const uint64_t *SlotKey(uint32_t slot) const { return &pool_keys_[slot * key_words_]; }
+
+    // the heap order by loss, then puzzle string, as compared on the packed keys.
+    bool SlotLess(uint32_t a, uint32_t b) const {
+        if (pool_losses_[a] != pool_losses_[b]) return pool_losses_[a] < pool_losses_[b];
+        const uint64_t *key_a = SlotKey(a);
+        const uint64_t *key_b = SlotKey(b);
+        for (int i = 0; i < key_words_; i++) {
+            if (key_a[i] != key_b[i]) return key_a[i] < key_b[i];
+        }
+        return false;
+    }
+
+    uint32_t AddSlot(const PatternKey &key, double loss) {
+        uint32_t slot = (uint32_t) pool_losses_.size();
+        pool_keys_.insert(pool_keys_.end(), key.words, key.words + key_words_);
+        pool_losses_.push_back(loss);
+        return slot;
+    }
+
+    void MakeHeap() {
+        auto less = [this](uint32_t a, uint32_t b) { return SlotLess(a, b); };
+        for (uint32_t slot = 0; slot < pool_losses_.size(); slot++) pattern_heap.push_back(slot);
+        make_heap(pattern_heap.begin(), pattern_heap.end(), less);
+        spare_slot_ = AddSlot(PatternKey(), 0.0);
+    }
+
     void InitEmpty() {
         double loss = numeric_limits<double>::max();
-        for (int i = 0; i < options_.num_puzzles_in_pool; i++) {
-            const string &initial = options_.pencilmark ? kInitPencilmark : kInitVanilla;
-            pattern_heap.emplace_back(make_pair(loss, initial));
-        }
-        make_heap(pattern_heap.begin(), pattern_heap.end());
+        const string &initial = options_.pencilmark ? kInitPencilmark : kInitVanilla;
+        PatternKey key = PackPattern(initial.c_str(), options_.pencilmark);
+        pool_keys_.reserve((options_.num_puzzles_in_pool + 1) * (size_t) key_words_);
+        pool_losses_.reserve(options_.num_puzzles_in_pool + 1);
+        for (int i = 0; i < options_.num_puzzles_in_pool; i++) AddSlot(key, loss);
+        MakeHeap();
     }
 
     bool HasUniqueSolution(const char *puzzle) {
@@ -83,14 +411,15 @@ struct Generator {
         return TdokuSolverDpllTriadSimd(puzzle, 2, 0, solution, &guesses) == 1;
     }
 
-    double MeanLogGuesses(char *puzzle) {
+    double MeanLogGuesses(char *puzzle, Util &util) {
         char solution[81];
         double sum_log_guesses = 0.0;
         for (int j = 0; j < options_.num_evals; j++) {
-            util_.PermuteSudoku(puzzle, options_.pencilmark);
+            util.PermuteSudoku(puzzle, options_.pencilmark);
             size_t guesses = 0;
             if (options_.solver == 1) {
 #ifdef MINISAT
+                lock_guard<mutex> lock(other_solver_mutex_);
                 OtherSolverMiniSat(puzzle, 1, 3, solution, &guesses);
 #else
                 cout << "Must build with -DMINISAT=on to use minisat" << endl;
@@ -98,6 +427,7 @@ struct Generator {
 #endif
             } else if (options_.solver == 2) {
 #ifdef GUROBI
+                lock_guard<mutex> lock(other_solver_mutex_);
                 OtherSolverGurobi(puzzle, 2, 0, solution, &guesses);
 #else
                 cout << "Must build with -DGUROBI=on to use gurobi" << endl;
@@ -127,18 +457,18 @@ struct Generator {
         return num_clues;
     }
 
-    tuple<int, double, double> Evaluate(const char *puzzle) {
+    tuple<int, double, double> Evaluate(const char *puzzle, Util &util) {
         char eval_puzzle[729];
         strncpy(eval_puzzle, puzzle, 729);
 
         int num_clues = NumClues(eval_puzzle);
-        double mean_log_guesses = MeanLogGuesses(eval_puzzle);
+        double mean_log_guesses = MeanLogGuesses(eval_puzzle, util);
 
         double loss;
         if (HasUniqueSolution(eval_puzzle)) {
             loss = num_clues * options_.clue_weight
                    - exp(mean_log_guesses * options_.guess_weight)
-                   + util_.RandomDouble() * options_.random_weight;
+                   + util.RandomDouble() * options_.random_weight;
         } else {
             loss = numeric_limits<double>::max();
         }
@@ -161,94 +491,160 @@ struct Generator {
             }
             line = line.substr(0, options_.pencilmark ? 729 : 81);
             strncpy(buffer, line.c_str(), 729);
-            double loss = get<2>(Evaluate(buffer));
-            pattern_heap.emplace_back(make_pair(loss, line));
-            pattern_set.insert(line);
+            double loss = get<2>(Evaluate(buffer, util_));
+            pattern_set.Insert(AddSlot(PackPattern(buffer, options_.pencilmark), loss));
             num_loaded++;
         }
-        make_heap(pattern_heap.begin(), pattern_heap.end());
+        MakeHeap();
     }
 
-    void Generate() {
-        char puzzle[729];
+    // draws a puzzle or pattern from the pool, loosens and re-completes it, and evaluates the
+    // result. safe to run concurrently with other candidates as long as the pool isn't modified.
+    Candidate MakeCandidate(int worker, uint64_t candidate_idx) {
+        Candidate candidate;
+        Util &util = worker_utils_[worker];
+        uint64_t seed = SplitMix64(base_seed_ + candidate_idx + 1);
+        util.RandomSeed(seed);
+        TdokuRandomSeed(SplitMix64(seed));
 
+        char puzzle[729];
         size_t size = options_.pencilmark ? 729 : 81;
-        for (uint64_t i = 0; i < options_.max_puzzles; i++) {
-            // draw a puzzle or pattern from the pool
-            size_t which = util_.RandomUInt() % pattern_heap.size();
-            string &pattern = pattern_heap[which].second;
-            memcpy(puzzle, pattern.c_str(), size);
-            if (size == 81) puzzle[81] = '\0';
-
-            // randomly drop clues to unconstrain
-            int dropped = 0;
-            for (int j : util_.Permutation(size)) {
-                if (dropped == options_.clues_to_drop) {
-                    break;
-                }
-                if (puzzle[j] == '.') {
-                    if (options_.pencilmark) {
-                        puzzle[j] = (char) ('1' + (j % 9));
-                        dropped++;
-                    }
-                } else {
-                    if (!options_.pencilmark) {
-                        puzzle[j] = '.';
-                        dropped++;
-                    }
-                }
-            }
 
-            // randomly complete and minimize
+        // draw a puzzle or pattern from the pool
+        size_t which = util.RandomUInt() % pattern_heap.size();
+        memcpy(candidate.source.words, SlotKey(pattern_heap[which]), key_words_ * sizeof(uint64_t));
+        UnpackPattern(candidate.source.words, options_.pencilmark, puzzle);
+        if (size == 81) puzzle[81] = '\0';
 
-            if (options_.clues_to_drop > 0) {
-                if (!TdokuConstrain(options_.pencilmark, puzzle)) {
-                    continue;
+        // randomly drop clues to unconstrain
+        int dropped = 0;
+        for (int j : util.Permutation(size)) {
+            if (dropped == options_.clues_to_drop) {
+                break;
+            }
+            if (puzzle[j] == '.') {
+                if (options_.pencilmark) {
+                    puzzle[j] = (char) ('1' + (j % 9));
+                    dropped++;
                 }
-                if (options_.minimize) {
-                    TdokuMinimize(options_.pencilmark, false, puzzle);
+            } else {
+                if (!options_.pencilmark) {
+                    puzzle[j] = '.';
+                    dropped++;
                 }
             }
+        }
 
-            // evaluate difficulty via guess counting
-            auto eval_stats = Evaluate(puzzle);
-            int num_clues = get<0>(eval_stats);
-            double geo_mean_guesses = get<1>(eval_stats);
-            double loss = get<2>(eval_stats);
+        // randomly complete and minimize
 
-            // skip if the puzzle is a duplicate of one still in the pool
-            if (options_.clues_to_drop > 0) {
-                if (strncmp(puzzle, pattern.c_str(), 729) == 0) {
-                    continue;
-                }
-                if (pattern_set.find(puzzle) != pattern_set.end()) {
-                    continue;
-                }
+        if (options_.clues_to_drop > 0) {
+            if (!TdokuConstrain(options_.pencilmark, puzzle)) {
+                return candidate;
             }
-
-            if (options_.display_all) {
-                printf("%.729s %d %.1f %.2f\n", puzzle, num_clues, geo_mean_guesses, loss);
+            if (options_.minimize) {
+                TdokuMinimize(options_.pencilmark, false, puzzle);
             }
+        }
+        candidate.key = PackPattern(puzzle, options_.pencilmark);
 
-            // skip if the puzzle's loss is greater than the highest in the pool
-            if (loss > pattern_heap.front().first) {
-                continue;
-            }
+        // skip the evaluation of puzzles seen before, if we're remembering them
+        if (seen_filter_.Enabled() && seen_filter_.MayContain(candidate.key)) {
+            candidate.filtered = true;
+            return candidate;
+        }
+
+        // evaluate difficulty via guess counting
+        auto eval_stats = Evaluate(puzzle, util);
+        candidate.valid = true;
+        candidate.puzzle.assign(puzzle, size);
+        candidate.num_clues = get<0>(eval_stats);
+        candidate.geo_mean_guesses = get<1>(eval_stats);
+        candidate.loss = get<2>(eval_stats);
+        return candidate;
+    }
+
+    void Merge(const Candidate &candidate) {
+        if (!candidate.valid) {
+            if (candidate.filtered) num_filtered_++;
+            return;
+        }
+        const char *puzzle = candidate.puzzle.c_str();
+        if (seen_filter_.Enabled()) seen_filter_.Insert(candidate.key);
 
-            if (!options_.display_all) {
-                printf("%.729s %d %.1f %.2f\n", puzzle, num_clues, geo_mean_guesses, loss);
+        // skip if the puzzle is a duplicate of one still in the pool
+        if (options_.clues_to_drop > 0) {
+            if (memcmp(candidate.key.words, candidate.source.words, sizeof(PatternKey)) == 0) {
+                return;
+            }
+            if (pattern_set.Contains(candidate.key.words)) {
+                return;
             }
+        }
+
+        if (options_.display_all) {
+            printf("%.729s %d %.1f %.2f\n", puzzle, candidate.num_clues,
+                   candidate.geo_mean_guesses, candidate.loss);
+        }
+
+        // skip if the puzzle's loss is greater than the highest in the pool
+        if (candidate.loss > pool_losses_[pattern_heap.front()]) {
+            return;
+        }
+
+        if (!options_.display_all) {
+            printf("%.729s %d %.1f %.2f\n", puzzle, candidate.num_clues,
+                   candidate.geo_mean_guesses, candidate.loss);
+        }
+
+        // add the generated puzzle to the pool and kick out the one with highest loss
+        auto less = [this](uint32_t a, uint32_t b) { return SlotLess(a, b); };
+        memcpy(SlotKey(spare_slot_), candidate.key.words, key_words_ * sizeof(uint64_t));
+        pool_losses_[spare_slot_] = candidate.loss;
+        pattern_set.Insert(spare_slot_);
+        pattern_heap.push_back(spare_slot_);
+        push_heap(pattern_heap.begin(), pattern_heap.end(), less);
+        pop_heap(pattern_heap.begin(), pattern_heap.end(), less);
+        spare_slot_ = pattern_heap.back();
+        pattern_set.Erase(SlotKey(spare_slot_));
+        pattern_heap.pop_back();
+    }
+
+    void Report(const char *what, uint64_t num_candidates, double seconds) {
+        fprintf(stderr, "generate: %s%llu candidates in %.1f s, %.1f candidates/sec on %d thread(s), "
+                        "%llu filtered, rss %.1f MB\n", what,
+                (unsigned long long) num_candidates, seconds, num_candidates / max(seconds, 1e-9),
+                options_.num_threads, (unsigned long long) num_filtered_,
+                ResidentKilobytes() / 1024.0);
+    }
 
-            // add the generated puzzle to the pool and kick out the one with highest loss
-            pattern_set.insert(puzzle);
-            pattern_heap.emplace_back(make_pair(loss, puzzle));
-            push_heap(pattern_heap.begin(), pattern_heap.end());
-            pop_heap(pattern_heap.begin(), pattern_heap.end());
-            if (pattern_set.find(pattern_heap.back().second) != pattern_set.end()) {
-                pattern_set.erase(pattern_heap.back().second);
+    void Generate() {
+        WorkerPool pool(options_.num_threads);
+        size_t batch_size = (size_t) options_.batch_size;
+        vector<Candidate> candidates(batch_size);
+
+        auto start = chrono::steady_clock::now();
+        double next_report = options_.report_seconds;
+        uint64_t num_candidates = 0;
+        while (num_candidates < options_.max_puzzles) {
+            size_t n = (size_t) min<uint64_t>(batch_size, options_.max_puzzles - num_candidates);
+            pool.Run(n, [&](int worker, size_t i) {
+                candidates[i] = MakeCandidate(worker, num_candidates + i);
+            });
+            for (size_t i = 0; i < n; i++) Merge(candidates[i]);
+            num_candidates += n;
+            if (options_.report_seconds > 0) {
+                double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+                if (seconds >= next_report) {
+                    fflush(stdout);
+                    Report("so far ", num_candidates, seconds);
+                    next_report = seconds + options_.report_seconds;
+                }
             }
-            pattern_heap.pop_back();
         }
+        fflush(stdout);
+
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        Report("", num_candidates, seconds);
     }
 };
 
@@ -257,7 +653,7 @@ int main(int argc, char **argv) {
 
     ketopt_t opt = KETOPT_INIT;
     char c;
-    while ((c = (char) ketopt(&opt, argc, argv, 1, "a::c:d:e:g:hl:m:n:p::r:s:u", nullptr)) != -1) {
+    while ((c = (char) ketopt(&opt, argc, argv, 1, "a::b:c:d:e:f:g:hj:l:m:n:p::r:s:t:uz:", nullptr)) != -1) {
         switch (c) {
             case 'c': {
                 options.clue_weight = stod(opt.arg);
@@ -303,6 +699,26 @@ int main(int argc, char **argv) {
                 options.solver = stoi(opt.arg);
                 break;
             }
+            case 'j': {
+                options.num_threads = max(1, stoi(opt.arg));
+                break;
+            }
+            case 'b': {
+                options.batch_size = max(1, stoi(opt.arg));
+                break;
+            }
+            case 'z': {
+                options.random_seed = stoull(opt.arg);
+                break;
+            }
+            case 'f': {
+                options.filter_bits = min(40, max(0, stoi(opt.arg)));
+                break;
+            }
+            case 't': {
+                options.report_seconds = stod(opt.arg);
+                break;
+            }
             case 'h':
             default: {
                 cout << "usage: generate <options> <pattern_file>\n" << endl;
@@ -318,6 +734,11 @@ int main(int argc, char **argv) {
                 cout << "  -a [0|1]            display all puzzles (not just top scored)\n";
                 cout << "  -p [0|1]            generate pencilmark puzzles\n";
                 cout << "  -s [0|1|2]          solver for eval: 0=tdoku,1=minisat,2=gurobi\n";
+                cout << "  -j <threads>        evaluate candidates on this many threads\n";
+                cout << "  -b <batch>          candidates per batch merged into pool [32]\n";
+                cout << "  -z <seed>           random seed; output then depends only on seed and batch\n";
+                cout << "  -f <log2 bits>      skip candidates seen before, per a bloom filter this big\n";
+                cout << "  -t <seconds>        report candidates/sec and memory this often\n";
                 cout << "  -h                  display this help message\n";
                 exit(0);
             }
@@ -1,6 +1,7 @@
 #include "grid_lib.h"
 #include "tdoku.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstdint>
 #include <cstring>
@@ -51,53 +52,163 @@ void GetPattern(int pattern_id, char *pattern) {
     pattern[81] = '\0';
 }
 
-extern "C"
-void GetGrid(size_t grid_idx, const void *index, const void *table, char *grid) {
-    size_t indexed_grid_idx = grid_idx & ~((1ull << 20u) - 1);
-    uint32_t current_pattern_idx = *(uint32_t *)(((char *)index) + (grid_idx >> 20u)* 6);
-    uint16_t indexed_grid_offset = *(uint16_t *)(((char *)index) + (grid_idx  >> 20u)* 6 + 4);
+namespace {
+
+// grid.index comes in two formats. the original has one entry per 2^20 grids, a uint32_t
+// pattern id and uint16_t offset into that pattern's solutions, from which lookups walk forward
+// through grid.counts one pattern at a time (about 150 patterns on average).
+//
+// version 2 starts with the header below and holds prefix sums of grid.counts at two levels:
+// a uint64_t grid count before each block of kBlockPatterns patterns (plus a final total), then
+// a uint32_t count before each group of kGroupPatterns patterns, relative to its block. lookups
+// binary search both levels and then walk at most kGroupPatterns - 1 patterns.
+struct GridIndexHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t block_patterns;
+    uint32_t group_patterns;
+    uint32_t reserved;
+    uint64_t num_patterns;
+    uint64_t num_grids;
+};
+
+constexpr char kGridIndexMagic[8] = {'t', 'd', 'g', 'r', 'i', 'd', 'x', '\0'};
+constexpr uint32_t kGridIndexVersion = 2;
+constexpr uint32_t kBlockPatterns = 4096;
+constexpr uint32_t kGroupPatterns = 64;
+
+size_t NumBlocks(size_t num_patterns) {
+    return (num_patterns + kBlockPatterns - 1) / kBlockPatterns;
+}
+
+size_t NumGroups(size_t num_patterns) {
+    return (num_patterns + kGroupPatterns - 1) / kGroupPatterns;
+}
+
+// where a grid id falls: a pattern, the number of that pattern's solutions to skip over, and
+// the pattern's solution count.
+struct GridLocation {
+    size_t pattern_idx;
+    size_t to_skip;
+    uint16_t pattern_count;
+};
 
-    size_t to_skip = indexed_grid_offset + (grid_idx  - indexed_grid_idx);
-    uint16_t pattern_count = *(((uint16_t *) table) + current_pattern_idx);
+GridLocation WalkCounts(size_t pattern_idx, size_t to_skip, const uint16_t *counts) {
+    uint16_t pattern_count = counts[pattern_idx];
     while (to_skip >= pattern_count) {
         to_skip -= pattern_count;
-        current_pattern_idx++;
-        pattern_count = *(((uint16_t *) table) + current_pattern_idx);
+        pattern_idx++;
+        pattern_count = counts[pattern_idx];
     }
-    char pattern[82];
-    GetPattern(current_pattern_idx, pattern);
-    size_t guesses;
-    SolveSudoku(pattern, to_skip + 1, 1, grid, &guesses);
+    return {pattern_idx, to_skip, pattern_count};
+}
+
+GridLocation Locate(size_t grid_idx, const void *index, const void *table) {
+    const auto *counts = static_cast<const uint16_t *>(table);
+    const auto *header = static_cast<const GridIndexHeader *>(index);
+    if (memcmp(header->magic, kGridIndexMagic, sizeof(kGridIndexMagic)) != 0) {
+        size_t indexed_grid_idx = grid_idx & ~((1ull << 20u) - 1);
+        uint32_t pattern_idx = *(uint32_t *)(((char *)index) + (grid_idx >> 20u)* 6);
+        uint16_t indexed_grid_offset = *(uint16_t *)(((char *)index) + (grid_idx  >> 20u)* 6 + 4);
+        return WalkCounts(pattern_idx, indexed_grid_offset + (grid_idx - indexed_grid_idx), counts);
+    }
+
+    size_t num_blocks = NumBlocks(header->num_patterns);
+    size_t num_groups = NumGroups(header->num_patterns);
+    const auto *blocks = reinterpret_cast<const uint64_t *>(header + 1);
+    const auto *groups = reinterpret_cast<const uint32_t *>(blocks + num_blocks + 1);
+
+    // the last block starting at or before grid_idx, then the last group within it.
+    size_t block = std::upper_bound(blocks, blocks + num_blocks + 1, grid_idx) - blocks - 1;
+    size_t to_skip = grid_idx - blocks[block];
+    size_t first_group = block * (kBlockPatterns / kGroupPatterns);
+    size_t end_group = std::min(first_group + kBlockPatterns / kGroupPatterns, num_groups);
+    size_t group = std::upper_bound(groups + first_group, groups + end_group, to_skip) - groups - 1;
+    to_skip -= groups[group];
+    return WalkCounts(group * kGroupPatterns, to_skip, counts);
 }
 
+}  // namespace
+
 extern "C"
-void EnumerateGrids(size_t first_grid_idx, size_t count,
-                    const void *index, const void *table,
-                    void (*callback)(const char *)) {
-    size_t indexed_grid_idx = first_grid_idx & ~((1ull << 20u) - 1);
-    uint32_t current_pattern_idx = *(uint32_t *)(((char *)index) + (first_grid_idx >> 20u)* 6);
-    uint16_t indexed_grid_offset = *(uint16_t *)(((char *)index) + (first_grid_idx  >> 20u)* 6 + 4);
+size_t GridIndexSize(size_t num_patterns) {
+    return sizeof(GridIndexHeader) + (NumBlocks(num_patterns) + 1) * sizeof(uint64_t)
+           + NumGroups(num_patterns) * sizeof(uint32_t);
+}
 
-    size_t to_skip = indexed_grid_offset + (first_grid_idx  - indexed_grid_idx);
-    uint16_t pattern_count = *(((uint16_t *) table) + current_pattern_idx);
-    while (to_skip >= pattern_count) {
-        to_skip -= pattern_count;
-        current_pattern_idx++;
-        pattern_count = *(((uint16_t *) table) + current_pattern_idx);
+extern "C"
+void MakeGridIndex(const void *table, size_t num_patterns, void *index) {
+    const auto *counts = static_cast<const uint16_t *>(table);
+    auto *header = static_cast<GridIndexHeader *>(index);
+    memset(header, 0, sizeof(GridIndexHeader));
+    memcpy(header->magic, kGridIndexMagic, sizeof(kGridIndexMagic));
+    header->version = kGridIndexVersion;
+    header->block_patterns = kBlockPatterns;
+    header->group_patterns = kGroupPatterns;
+    header->num_patterns = num_patterns;
+
+    auto *blocks = reinterpret_cast<uint64_t *>(header + 1);
+    auto *groups = reinterpret_cast<uint32_t *>(blocks + NumBlocks(num_patterns) + 1);
+    uint64_t num_grids = 0;
+    uint64_t block_base = 0;
+    for (size_t pattern_idx = 0; pattern_idx < num_patterns; pattern_idx++) {
+        if (pattern_idx % kBlockPatterns == 0) {
+            block_base = num_grids;
+            blocks[pattern_idx / kBlockPatterns] = num_grids;
+        }
+        if (pattern_idx % kGroupPatterns == 0) {
+            groups[pattern_idx / kGroupPatterns] = (uint32_t) (num_grids - block_base);
+        }
+        num_grids += counts[pattern_idx];
     }
+    blocks[NumBlocks(num_patterns)] = num_grids;
+    header->num_grids = num_grids;
+}
+
+extern "C"
+void LocateGrid(size_t grid_idx, const void *index, const void *table, size_t *pattern_idx,
+                size_t *to_skip) {
+    GridLocation location = Locate(grid_idx, index, table);
+    *pattern_idx = location.pattern_idx;
+    *to_skip = location.to_skip;
+}
+
+extern "C"
+void GetGrid(size_t grid_idx, const void *index, const void *table, char *grid) {
+    GridLocation location = Locate(grid_idx, index, table);
+    char pattern[82];
+    GetPattern((int) location.pattern_idx, pattern);
+    size_t guesses;
+    // seek from whichever end of the pattern's solutions is closer.
+    size_t from_end = location.pattern_count - location.to_skip;
+    if (from_end <= location.to_skip) {
+        TdokuSolveReverse(pattern, from_end, grid, &guesses);
+    } else {
+        SolveSudoku(pattern, location.to_skip + 1, 1, grid, &guesses);
+    }
+}
+
+extern "C"
+void EnumerateGridsWithArg(size_t first_grid_idx, size_t count,
+                           const void *index, const void *table,
+                           void (*callback)(const char *, void *), void *callback_arg) {
+    GridLocation location = Locate(first_grid_idx, index, table);
+    size_t current_pattern_idx = location.pattern_idx;
+    size_t to_skip = location.to_skip;
+    uint16_t pattern_count = location.pattern_count;
     size_t remaining = count;
     while (remaining > 0) {
         size_t limit = to_skip + remaining;
         if (limit > pattern_count) limit = pattern_count;
 
         char pattern[82];
-        GetPattern(current_pattern_idx, pattern);
+        GetPattern((int) current_pattern_idx, pattern);
 
         auto skipping_callback=[&](const char *grid){
             if (to_skip > 0) {
                 to_skip--;
             } else {
-                callback(grid);
+                callback(grid, callback_arg);
                 remaining--;
             }
         };
@@ -111,19 +222,11 @@ void EnumerateGrids(size_t first_grid_idx, size_t count,
     }
 }
 
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
+extern "C"
+void EnumerateGrids(size_t first_grid_idx, size_t count,
+                    const void *index, const void *table,
+                    void (*callback)(const char *)) {
+    EnumerateGridsWithArg(first_grid_idx, count, index, table, [](const char *grid, void *arg) {
+        (*static_cast<void (**)(const char *)>(arg))(grid);
+    }, &callback);
+}
@@ -8,6 +8,34 @@ extern "C"
 #endif
 void GetPattern(int pattern_id, char *pattern);
 
+// the size of, and contents of, a version 2 grid.index for the given grid.counts table.
+#ifdef __cplusplus
+extern "C"
+#endif
+size_t GridIndexSize(size_t num_patterns);
+
+#ifdef __cplusplus
+extern "C"
+#endif
+void MakeGridIndex(const void *table, size_t num_patterns, void *index);
+
+// the pattern a grid id falls in and how many of that pattern's solutions come before it.
+// index may be either a version 2 grid.index or one in the original format.
+#ifdef __cplusplus
+extern "C"
+#endif
+void LocateGrid(size_t grid_idx, const void *index, const void *table, size_t *pattern_idx,
+                size_t *to_skip);
+
+// tdoku's solver searching in reverse order: returns the limit-th solution from the end of
+// the order SolveSudoku and TdokuEnumerate find them in. internal to GetGrid's seeks (defined
+// with the solver, and dispatched like it), and kept out of tdoku.h.
+#ifdef __cplusplus
+extern "C"
+#endif
+size_t TdokuSolveReverse(const char *puzzle, size_t limit, char *solution, size_t *num_guesses);
+
+// index may be either a version 2 grid.index or one in the original format.
 #ifdef __cplusplus
 extern "C"
 #endif
@@ -19,5 +47,14 @@ extern "C"
 void EnumerateGrids(size_t first_grid_idx, size_t count, const void *index, const void *table,
                     void (*callback)(const char *));
 
+// as above, passing callback_arg through to each callback. safe to call from several threads
+// at once (over the same read-only index and table).
+#ifdef __cplusplus
+extern "C"
+#endif
+void EnumerateGridsWithArg(size_t first_grid_idx, size_t count,
+                           const void *index, const void *table,
+                           void (*callback)(const char *, void *), void *callback_arg);
+
 #endif  // TDOKU_GRID_LIB_H
 
@@ -1,16 +1,33 @@
 #include "grid_lib.h"
 #include "tdoku.h"
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <cstring>
 #include <fcntl.h>
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <mutex>
 #include <random>
+#include <string>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <thread>
+#include <vector>
 
 using namespace std;
 
+struct Options {
+    // worker threads for list_grids, sample_grids, sample_puzzles and minimize.
+    int num_threads = 1;
+    // whether to write each worker's output in the order a single thread would have.
+    bool ordered = true;
+    // seed from which minimize derives each puzzle's order of clue removal.
+    uint64_t seed = 0;
+};
+
 void ListPatterns(uint64_t pattern_id, uint64_t limit) {
     char pattern[82];
     for (int i = 0; i < limit; i++) {
@@ -31,83 +48,175 @@ void CountGrids(int start, int limit) {
     }
 }
 
-constexpr int index_step = 1024 * 1024;
+void *MMapFile(const char *file_path, size_t *file_size = nullptr) {
+    int fd = open(file_path, O_RDONLY);
+    if (fd < 0) {
+        cout << "Could not open file: " << file_path << endl;
+        exit(1);
+    }
+    struct stat statbuf;
+    fstat(fd, &statbuf);
+    void *mapped = mmap(nullptr, statbuf.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) {
+        cout << "Could not memory map file: " << file_path << endl;
+        exit(1);
+    }
+    madvise(mapped, statbuf.st_size, MADV_WILLNEED);
+    if (file_size != nullptr) *file_size = statbuf.st_size;
+    return mapped;
+}
+
+// writes a version 2 grid.index (see grid_lib.cc) for the grid.counts in the current directory.
+void MakeIndex() {
+    size_t counts_size;
+    void *table = MMapFile("grid.counts", &counts_size);
+    size_t num_patterns = counts_size / sizeof(uint16_t);
+    vector<char> index(GridIndexSize(num_patterns));
+    MakeGridIndex(table, num_patterns, index.data());
+    munmap(table, counts_size);
+
+    ofstream table_index("grid.index", ios::out | ios::binary);
+    table_index.write(index.data(), index.size());
+    table_index.close();
+}
 
 void MakeTables() {
     char *line = nullptr;
     size_t size;
 
-    size_t pattern_index = 0;
-    size_t pattern_base_puzzle_index = 0;
-    size_t next_puzzle_index = 0;
-
     ofstream table_fast("grid.counts", ios::out | ios::binary);
-    ofstream table_index("grid.index", ios::out | ios::binary);
-
     while (getline(&line, &size, stdin) != -1) {
         string s(line);
         uint16_t pattern_count = stoi(s.substr(s.find_last_of('\t')));
+        table_fast.write(reinterpret_cast<const char *>(&pattern_count), sizeof(uint16_t));
+    }
+    table_fast.close();
+    MakeIndex();
+}
+
+// Splits a job into numbered chunks (num_chunks may be UINT64_MAX for "until killed") which the
+// worker threads claim in turn. produce(worker, chunk, &out) appends the chunk's output lines to
+// out, which is written to stdout as soon as the chunk is done, or, if ordered, once every earlier
+// chunk has been written. to bound the memory held by finished but unwritten chunks, no worker
+// starts a chunk more than 2 * num_threads chunks ahead of the next one to be written.
+template<typename Produce>
+void RunChunks(uint64_t num_chunks, const Options &options, Produce produce) {
+    mutex mu;
+    condition_variable writable;
+    uint64_t next_chunk = 0;
+    uint64_t next_to_write = 0;
+    map<uint64_t, string> finished;
+    const uint64_t window = 2 * (uint64_t) options.num_threads;
+
+    auto work = [&](int worker) {
+        string out;
+        unique_lock<mutex> lock(mu);
+        while (true) {
+            if (options.ordered) {
+                writable.wait(lock, [&] {
+                    return next_chunk >= num_chunks || next_chunk < next_to_write + window;
+                });
+            }
+            if (next_chunk >= num_chunks) return;
+            uint64_t chunk = next_chunk++;
+            lock.unlock();
 
-        if (next_puzzle_index < pattern_base_puzzle_index + pattern_count) {
-            uint16_t puzzle_offset = next_puzzle_index - pattern_base_puzzle_index;
-            table_index.write(reinterpret_cast<const char *>(&pattern_index), sizeof(uint32_t));
-            table_index.write(reinterpret_cast<const char *>(&puzzle_offset), sizeof(uint16_t));
-            next_puzzle_index += index_step;
+            out.clear();
+            produce(worker, chunk, &out);
+
+            lock.lock();
+            if (!options.ordered) {
+                fwrite(out.data(), 1, out.size(), stdout);
+                continue;
+            }
+            finished.emplace(chunk, std::move(out));
+            out = string();
+            while (!finished.empty() && finished.begin()->first == next_to_write) {
+                const string &ready = finished.begin()->second;
+                fwrite(ready.data(), 1, ready.size(), stdout);
+                finished.erase(finished.begin());
+                next_to_write++;
+            }
+            writable.notify_all();
         }
+    };
 
-        pattern_index++;
-        pattern_base_puzzle_index += pattern_count;
+    vector<thread> threads;
+    for (int i = 0; i < options.num_threads; i++) threads.emplace_back(work, i);
+    for (thread &t : threads) t.join();
+    fflush(stdout);
+}
 
-        table_fast.write(reinterpret_cast<const char *>(&pattern_count), sizeof(uint16_t));
-    }
-    table_fast.close();
-    table_index.close();
+double SecondsSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
 }
 
-void *MMapFile(const char *file_path) {
-    int fd = open(file_path, O_RDONLY);
-    if (fd < 0) {
-        cout << "Could not open file: " << file_path << endl;
-        exit(1);
-    }
-    struct stat statbuf;
-    fstat(fd, &statbuf);
-    void *mapped = mmap(nullptr, statbuf.st_size, PROT_READ, MAP_SHARED, fd, 0);
-    if (mapped == MAP_FAILED) {
-        cout << "Could not memory map file: " << file_path << endl;
-        exit(1);
-    }
-    madvise(mapped, statbuf.st_size, MADV_WILLNEED);
-    return mapped;
+void ReportThroughput(const char *what, uint64_t count, double seconds,
+                      const Options &options, const char *unit = "grids") {
+    fprintf(stderr, "%s: %llu %s in %.2f s, %.0f %s/sec on %d thread(s)\n", what,
+            (unsigned long long) count, unit, seconds, count / max(seconds, 1e-9), unit,
+            options.num_threads);
 }
 
-void ListGrids(uint64_t grid_id, uint64_t limit) {
+// enumeration restarts at the beginning of a pattern's solutions for each chunk, skipping up to
+// a pattern's worth of grids (a few thousand), so chunks need to be much bigger than that.
+constexpr uint64_t list_chunk_size = 1u << 15u;
+
+void ListGrids(uint64_t grid_id, uint64_t limit, const Options &options) {
     void *table = MMapFile("grid.counts");
     void *index = MMapFile("grid.index");
 
-    EnumerateGrids(grid_id, limit, index, table, [](const char *grid) {
-        printf("%.81s\n", grid);
+    auto start = chrono::steady_clock::now();
+    uint64_t num_chunks = (limit + list_chunk_size - 1) / list_chunk_size;
+    RunChunks(num_chunks, options, [&](int, uint64_t chunk, string *out) {
+        uint64_t first = grid_id + chunk * list_chunk_size;
+        uint64_t count = min(list_chunk_size, grid_id + limit - first);
+        out->reserve(count * 82);
+        EnumerateGridsWithArg(first, count, index, table, [](const char *grid, void *arg) {
+            string *out = static_cast<string *>(arg);
+            out->append(grid, 81);
+            out->push_back('\n');
+        }, out);
     });
+    ReportThroughput("list_grids", limit, SecondsSince(start), options);
 }
 
 constexpr size_t num_equivalence_classes = 27704267971ll * 128;
 
-namespace {
-    std::random_device rd{};
-    std::mt19937_64 rng{rd()};
-    std::uniform_int_distribution<uint64_t> random_uint{};
+// one random stream per worker thread.
+vector<mt19937_64> WorkerRngs(const Options &options) {
+    random_device rd{};
+    vector<mt19937_64> rngs;
+    for (int i = 0; i < options.num_threads; i++) {
+        seed_seq seed{rd(), rd(), rd(), rd()};
+        rngs.emplace_back(seed);
+    }
+    return rngs;
 }
 
-void SampleGrids(int64_t limit) {
+constexpr uint64_t sample_chunk_size = 1024;
+
+void SampleGrids(int64_t limit, const Options &options) {
     void *table = MMapFile("grid.counts");
     void *index = MMapFile("grid.index");
 
-    char grid[81];
-    while (limit-- != 0) {
-        size_t grid_id = random_uint(rng) % num_equivalence_classes;
-        GetGrid(grid_id, index, table, grid);
-        printf("%.81s\t%zu\n", grid, grid_id);
-    }
+    vector<mt19937_64> rngs = WorkerRngs(options);
+    auto start = chrono::steady_clock::now();
+    uint64_t num_chunks = limit < 0 ? UINT64_MAX : (limit + sample_chunk_size - 1) / sample_chunk_size;
+    RunChunks(num_chunks, options, [&](int worker, uint64_t chunk, string *out) {
+        uniform_int_distribution<uint64_t> random_uint{};
+        uint64_t count = sample_chunk_size;
+        if (limit >= 0) count = min(count, (uint64_t) limit - chunk * sample_chunk_size);
+        char line[128];
+        char grid[81];
+        for (uint64_t i = 0; i < count; i++) {
+            size_t grid_id = random_uint(rngs[worker]) % num_equivalence_classes;
+            GetGrid(grid_id, index, table, grid);
+            int length = snprintf(line, sizeof(line), "%.81s\t%zu\n", grid, grid_id);
+            out->append(line, length);
+        }
+    });
+    ReportThroughput("sample_grids", limit, SecondsSince(start), options);
 }
 
 // when sampling a grid each equally probable permutation leads to exactly zero or one
@@ -121,22 +230,66 @@ static double SamplingWeight(int clues) {
     return exp(lgamma(41) + lgamma(42) - lgamma(clues + 1) - lgamma(82 - clues));
 }
 
-void SamplePuzzles(int64_t limit) {
+void SamplePuzzles(int64_t limit, const Options &options) {
     void *table = MMapFile("grid.counts");
     void *index = MMapFile("grid.index");
 
-    char grid[81];
-    while (limit != 0) {
-        size_t grid_id = random_uint(rng) % num_equivalence_classes;
-        GetGrid(grid_id, index, table, grid);
-        if (TdokuMinimize(false, true, grid)) {
-            int num_clues = 0;
-            for (char c : grid) num_clues += (c != '.');
-            double weight = SamplingWeight(num_clues);
-            printf("%.81s\t%f\n", grid, weight);
-            limit--;
+    vector<mt19937_64> rngs = WorkerRngs(options);
+    vector<uint64_t> grids_sampled(options.num_threads);
+    auto start = chrono::steady_clock::now();
+    // each chunk is one accepted puzzle, since it takes a great many rejected grids to find one.
+    uint64_t num_chunks = limit < 0 ? UINT64_MAX : (uint64_t) limit;
+    RunChunks(num_chunks, options, [&](int worker, uint64_t, string *out) {
+        uniform_int_distribution<uint64_t> random_uint{};
+        char line[128];
+        char grid[81];
+        while (true) {
+            size_t grid_id = random_uint(rngs[worker]) % num_equivalence_classes;
+            GetGrid(grid_id, index, table, grid);
+            grids_sampled[worker]++;
+            if (TdokuMinimize(false, true, grid)) {
+                int num_clues = 0;
+                for (char c : grid) num_clues += (c != '.');
+                double weight = SamplingWeight(num_clues);
+                int length = snprintf(line, sizeof(line), "%.81s\t%f\n", grid, weight);
+                out->append(line, length);
+                return;
+            }
         }
+    });
+    uint64_t total_sampled = 0;
+    for (uint64_t n : grids_sampled) total_sampled += n;
+    ReportThroughput("sample_puzzles", total_sampled, SecondsSince(start), options);
+}
+
+constexpr size_t minimize_batch_size = 4096;
+
+// minimizes the grids or puzzles read from stdin (one per line, '.' or '0' for empty cells),
+// a batch at a time on the requested number of threads, writing them out in input order.
+void MinimizePuzzles(const Options &options) {
+    vector<char> batch(minimize_batch_size * 81);
+    char *line = nullptr;
+    size_t size;
+    uint64_t num_minimized = 0;
+    double seconds = 0.0;
+    bool more = true;
+    while (more) {
+        size_t num_puzzles = 0;
+        while (num_puzzles < minimize_batch_size && (more = getline(&line, &size, stdin) != -1)) {
+            if (strlen(line) < 81) continue;
+            char *puzzle = &batch[num_puzzles++ * 81];
+            for (int i = 0; i < 81; i++) puzzle[i] = line[i] == '0' ? '.' : line[i];
+        }
+        auto start = chrono::steady_clock::now();
+        TdokuMinimizeBatch(false, false, num_puzzles, batch.data(), nullptr, options.num_threads,
+                           options.seed + num_minimized);
+        seconds += SecondsSince(start);
+        for (size_t i = 0; i < num_puzzles; i++) printf("%.81s\n", &batch[i * 81]);
+        num_minimized += num_puzzles;
     }
+    free(line);
+    fflush(stdout);
+    ReportThroughput("minimize", num_minimized, seconds, options, "puzzles");
 }
 
 void usage() {
@@ -173,6 +326,11 @@ Now make the tables, taking care to consume the chunks of counts in order:
 
   build/grid_tools make_tables < <(cat chunk.{0..63})
 
+Tables made before grid.index had a version header still work, but lookups
+are faster with the current index, which you can rebuild from grid.counts:
+
+  build/grid_tools make_index
+
 With the generated tables and index in the current directory you can now get
 any numbered grid in range(27704267971*2^7), or you can sample grids randomly:
 
@@ -184,11 +342,47 @@ like so:
 
   build/grid_gools sample_puzzles [<limit>=-1]
 
+Or minimize grids or puzzles of your own, one per line on stdin:
+
+  build/grid_tools minimize < puzzles.txt
+
+These four commands accept options before the command name:
+
+  -j <threads>   split the work across this many threads [default 1]
+  -u             write each thread's output as soon as it's ready, instead of
+                 in the order a single thread would produce it
+  -s <seed>      seed minimize's random choices, which depend only on the seed
+                 and each puzzle's line number [default 0]
+
+e.g., build/grid_tools -j 64 list_grids 0 100000000 > grids.txt
+
+Each reports its throughput in grids/sec (puzzles/sec for minimize) to stderr
+when done.
+
 )USAGE";
     exit(0);
 }
 
 int main(int argc, char **argv) {
+    Options options{};
+    while (argc > 1 && argv[1][0] == '-') {
+        string flag(argv[1]);
+        if (flag == "-j" && argc > 2) {
+            options.num_threads = max(1, stoi(argv[2]));
+            argc -= 2;
+            argv += 2;
+        } else if (flag == "-s" && argc > 2) {
+            options.seed = stoull(argv[2]);
+            argc -= 2;
+            argv += 2;
+        } else if (flag == "-u") {
+            options.ordered = false;
+            argc -= 1;
+            argv += 1;
+        } else {
+            usage();
+        }
+    }
     if (argc > 1) {
         string command(argv[1]);
         if (command == "pattern") {
@@ -208,20 +402,26 @@ int main(int argc, char **argv) {
         } else if (command == "make_tables") {
             MakeTables();
             return 0;
+        } else if (command == "make_index") {
+            MakeIndex();
+            return 0;
         } else if (command == "list_grids") {
             if (argc > 2) {
                 uint64_t start = stoull(argv[2]);
                 uint64_t limit = argc > 3 ? stoull(argv[3]) : 1u;
-                ListGrids(start, limit);
+                ListGrids(start, limit, options);
                 return 0;
             }
         } else if (command == "sample_grids") {
             int64_t limit = argc > 2 ? stoll(argv[2]) : -1;
-            SampleGrids(limit);
+            SampleGrids(limit, options);
             return 0;
         } else if (command == "sample_puzzles") {
             int64_t limit = argc > 2 ? stoll(argv[2]) : -1;
-            SamplePuzzles(limit);
+            SamplePuzzles(limit, options);
+            return 0;
+        } else if (command == "minimize") {
+            MinimizePuzzles(options);
             return 0;
         }
     }
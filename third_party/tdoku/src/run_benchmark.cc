@@ -1,18 +1,36 @@
 #include "all_solvers.h"
 #include "build_info.h"
+#include "drake.h"
 #include "klib/ketopt.h"
 #include "util.h"
 
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <cctype>
 #include <chrono>
+#include <cmath>
+#include <condition_variable>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <random>
 #include <sstream>
+#include <thread>
 #include <vector>
+#ifdef __linux__
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 using namespace std;
 using chrono::steady_clock;
@@ -42,27 +60,294 @@ struct Options {
     // if randomizing, the random seed to use. If the given (or default) random seed is zero
     // then rd() will be used.
     uint64_t random_seed = 0;
+    // the number of threads for preparing datasets (zero for one per core). the result doesn't
+    // depend on it.
+    int load_threads = 0;
+    // the number of threads for rating (zero for one per allowed cpu). more than one needs
+    // solvers that are ThreadSafe.
+    int rate_threads = 1;
     // whether to stop at the first solution vs. validating uniqueness.
     bool first_solution = false;
+    // the solution limit when not stopping at the first solution. the default of 2 validates
+    // uniqueness; larger limits benchmark solution counting (e.g., together with -u).
+    size_t solution_limit = 2;
+    // the number of clues to blank out at random in each loaded puzzle, making under-constrained
+    // puzzles with many solutions. vanilla sudoku only.
+    int remove_clues = 0;
+    // a per-puzzle budget in guesses and microseconds (DRAKE_NO_GUESS_LIMIT and
+    // DRAKE_NO_TIME_LIMIT for none; zero is a budget). if either is set, each dataset is solved
+    // once with the drake library under the budget instead of benchmarked, and the puzzles that
+    // exceed it are counted.
+    size_t budget_guesses = DRAKE_NO_GUESS_LIMIT;
+    uint64_t budget_usec = DRAKE_NO_TIME_LIMIT;
     // whether to validate puzzle solutions during warmup. we don't validate results during
     // actual benchmarking.
     bool validate = true;
     // whether to output results in csv format instead of markdown table format
     bool csv_output = false;
+    // if non-empty, the id of a reference solver whose guess counts are used to bucket the
+    // dataset by difficulty. each solver is then also timed separately on each bucket.
+    string stratify_solver_id{};
+    // whether to replace "tdoku" with one solver per instruction set build it was compiled for.
+    bool isa_variants = false;
+    // a sweep: each solver is run with each of these configurations (instead of its own) and,
+    // if it takes one, each of these thread counts, and the combinations that are fastest for
+    // their guess counts are summarized after each dataset.
+    vector<uint32_t> sweep_configurations{};
+    vector<uint32_t> sweep_threads{};
+    // if non-empty, the cores to measure throughput on instead: one pinned worker per core,
+    // each solving its own shard of the dataset, which it allocates and fills itself so that
+    // the shard lands on its NUMA node.
+    vector<int> worker_cores{};
+    // what backs the workers' shards: 0 for normal pages, 1 for transparent huge pages
+    // (madvise), 2 for explicit ones (MAP_HUGETLB, else transparent if none are reserved).
+    int huge_pages = 0;
     // the set of solvers to benchmark
     vector<Solver> solvers{GetAllSolvers()};
+
+    bool Budgeted() const {
+        return budget_guesses != DRAKE_NO_GUESS_LIMIT || budget_usec != DRAKE_NO_TIME_LIMIT;
+    }
+
+    bool Sweep() const {
+        return !sweep_configurations.empty() || !sweep_threads.empty();
+    }
+};
+
+// parses a list of values and ranges such as "0-3,7,0x10".
+vector<uint32_t> ParseValues(const string &list) {
+    vector<uint32_t> values;
+    stringstream ss(list);
+    string item;
+    while (getline(ss, item, ',')) {
+        size_t dash = item.find('-', 1);
+        auto first = (uint32_t) stoul(item.substr(0, dash), nullptr, 0);
+        auto last = dash == string::npos ? first : (uint32_t) stoul(item.substr(dash + 1), nullptr, 0);
+        for (uint32_t value = first; value <= last; value++) values.push_back(value);
+    }
+    return values;
+}
+
+// each solver once per swept configuration and, for solvers that take one, thread count,
+// named for the combination, e.g. "drake/lib_count:3/4t".
+vector<Solver> SweepSolvers(const Options &options) {
+    vector<Solver> solvers;
+    for (const Solver &solver : options.solvers) {
+        vector<uint32_t> configurations = options.sweep_configurations;
+        if (configurations.empty()) configurations.push_back(solver.Configuration());
+        for (uint32_t configuration : configurations) {
+            string id = solver.Id() + ":" + to_string(configuration);
+            if (!solver.TakesThreadCount() || options.sweep_threads.empty()) {
+                solvers.push_back(solver.Reconfigured(configuration, id));
+                continue;
+            }
+            for (uint32_t threads : options.sweep_threads) {
+                solvers.push_back(solver.Reconfigured((configuration & 0xffffu) | threads << 16u,
+                                                      id + "/" + to_string(threads) + "t"));
+            }
+        }
+    }
+    return solvers;
+}
+
+// pins the calling thread to a cpu. linux only.
+void PinToCpu(int cpu) {
+#ifdef __linux__
+    if (cpu < 0 || cpu >= CPU_SETSIZE) return;
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#else
+    (void) cpu;
+#endif
+}
+
+// the NUMA node of a cpu per sysfs, or 0 where that's unknown.
+int NodeOfCpu(int cpu) {
+    int node = 0;
+#ifdef __linux__
+    DIR *dir = opendir(("/sys/devices/system/cpu/cpu" + to_string(cpu)).c_str());
+    if (dir == nullptr) return node;
+    while (dirent *entry = readdir(dir)) {
+        if (strncmp(entry->d_name, "node", 4) == 0 && isdigit(entry->d_name[4])) {
+            node = atoi(entry->d_name + 4);
+            break;
+        }
+    }
+    closedir(dir);
+#else
+    (void) cpu;
+#endif
+    return node;
+}
+
+// the cpus this process may run on, in order.
+vector<int> AvailableCpus() {
+    vector<int> cpus;
+#ifdef __linux__
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &allowed)) cpus.push_back(cpu);
+        }
+    }
+#endif
+    if (cpus.empty()) {
+        for (int cpu = 0; cpu < (int) max(1u, thread::hardware_concurrency()); cpu++) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+// pins the calling thread to one of the cpus the process may run on (modulo their number), so
+// that a rating worker's timings aren't skewed by migrating or sharing a core with another.
+// linux only.
+void PinToCore(int worker, const vector<int> &cpus) {
+    if (!cpus.empty()) PinToCpu(cpus[worker % cpus.size()]);
+}
+
+// whether every solver may run on several threads at once. if not, warns that what is named
+// will run on one thread.
+bool SolversThreadSafe(const vector<Solver> &solvers, const char *what) {
+    bool thread_safe = true;
+    for (const Solver &solver : solvers) {
+        if (solver.ThreadSafe()) continue;
+        cerr << solver.Id() << " keeps shared state between calls, so " << what
+             << " runs on one thread" << endl;
+        thread_safe = false;
+    }
+    return thread_safe;
+}
+
+// worker cores from a list such as "0-3,8" or a policy over the available cpus, optionally
+// with a count: "compact:4" fills a NUMA node before moving to the next, "spread:4" takes a
+// cpu from each node in turn.
+vector<int> ParseCores(const string &arg) {
+    size_t colon = arg.find(':');
+    string policy = arg.substr(0, colon);
+    if (policy != "compact" && policy != "spread") {
+        vector<uint32_t> values = ParseValues(arg);
+        return vector<int>(values.begin(), values.end());
+    }
+    vector<int> cpus = AvailableCpus();
+    map<int, vector<int>> cpus_by_node;
+    for (int cpu : cpus) cpus_by_node[NodeOfCpu(cpu)].push_back(cpu);
+    vector<int> cores;
+    if (policy == "compact") {
+        for (const auto &node : cpus_by_node) {
+            cores.insert(cores.end(), node.second.begin(), node.second.end());
+        }
+    } else {
+        for (size_t round = 0; cores.size() < cpus.size(); round++) {
+            for (const auto &node : cpus_by_node) {
+                if (round < node.second.size()) cores.push_back(node.second[round]);
+            }
+        }
+    }
+    if (colon != string::npos) cores.resize(min(cores.size(), (size_t) stoul(arg.substr(colon + 1))));
+    return cores;
+}
+
+// memory for one worker's shard of the dataset, on the pages Options::huge_pages asks for.
+// like any anonymous memory it is placed on a NUMA node when first touched.
+class ShardMemory {
+public:
+    ShardMemory(size_t bytes, int huge_pages) {
+#ifdef __linux__
+        const size_t kHugePageSize = 2u << 20u;
+        size_t rounded = max<size_t>(1, (bytes + kHugePageSize - 1) / kHugePageSize) * kHugePageSize;
+        void *memory = MAP_FAILED;
+        if (huge_pages == 2) {
+            memory = mmap(nullptr, rounded, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            static atomic<bool> warned{false};
+            if (memory == MAP_FAILED && !warned.exchange(true)) {
+                cerr << "no explicit huge pages reserved (see vm.nr_hugepages), using transparent"
+                     << endl;
+            }
+        }
+        if (memory == MAP_FAILED) {
+            // map a huge page extra and trim it to a huge page boundary so that transparent huge
+            // pages can back all of it.
+            size_t span = rounded + kHugePageSize;
+            auto *raw = (char *) mmap(nullptr, span, PROT_READ | PROT_WRITE,
+                                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (raw == MAP_FAILED) {
+                cout << "Error allocating " << bytes << " bytes" << endl;
+                exit(1);
+            }
+            char *aligned = raw + (kHugePageSize - (uintptr_t) raw % kHugePageSize) % kHugePageSize;
+            if (aligned > raw) munmap(raw, aligned - raw);
+            if (raw + span > aligned + rounded) munmap(aligned + rounded, raw + span - (aligned + rounded));
+            memory = aligned;
+            if (huge_pages > 0) madvise(memory, rounded, MADV_HUGEPAGE);
+        }
+        data_ = (char *) memory;
+        mapped_bytes_ = rounded;
+#else
+        (void) huge_pages;
+        data_ = new char[max<size_t>(bytes, 1)];
+#endif
+    }
+
+    ~ShardMemory() {
+#ifdef __linux__
+        munmap(data_, mapped_bytes_);
+#else
+        delete[] data_;
+#endif
+    }
+
+    ShardMemory(const ShardMemory &) = delete;
+    ShardMemory &operator=(const ShardMemory &) = delete;
+
+    char *Data() const { return data_; }
+
+    // the NUMA node holding the first page, once touched, or -1 if that's unknown.
+    int Node() const {
+#if defined(__linux__) && defined(SYS_move_pages)
+        void *page = data_;
+        int status = -1;
+        if (syscall(SYS_move_pages, 0, 1, &page, nullptr, &status, 0) == 0 && status >= 0) {
+            return status;
+        }
+#endif
+        return -1;
+    }
+
+private:
+    char *data_ = nullptr;
+    size_t mapped_bytes_ = 0;
 };
 
 struct Benchmark {
     const Options options_;
     const size_t puzzle_size_;
     const size_t puzzle_buf_size_; // puzzle_size_ rounded up for alignment
-    vector<char> dataset_{};
+    // left uninitialized when allocated: each slot is written in full, padding included (see
+    // StorePuzzle), and most are written in parallel, so a large dataset's page faults are too.
+    unique_ptr<char[]> dataset_{};
     // when validating puzzles during warmup it is an error if the solver can not find a
     // solution, UNLESS the dataset indicates that it contains puzzles with no solutions
     // via a comment at the top of the file containing the string 'ALLOWZERO'.
     bool allow_zero_ = false;
 
+    // difficulty buckets by reference solver guess count, and the dataset indices in each.
+    static constexpr int kNumBuckets = 5;
+    const array<const char *, kNumBuckets> kBucketLabels{{"0", "1", "2-3", "4-15", "16+"}};
+    array<vector<size_t>, kNumBuckets> buckets_{};
+
+    // the time and guesses per puzzle of each solver on the current dataset, for the summary
+    // of a sweep.
+    struct Measurement {
+        string id;
+        double usec_per_puzzle;
+        double guesses_per_puzzle;
+    };
+    vector<Measurement> measurements_{};
+
     Util util;
 
     explicit Benchmark(const Options &options) :
@@ -101,8 +386,7 @@ struct Benchmark {
         }
 
         allow_zero_ = false;
-        dataset_.resize(options_.test_dataset_size * puzzle_buf_size_);
-        fill(dataset_.begin(), dataset_.end(), 0);
+        AllocateDataset();
 
         // load input file; if there are more puzzles in the input file than we want in our
         // test dataset then sample such that each input puzzle has the same probability of
@@ -117,16 +401,12 @@ struct Benchmark {
                 if (line.length() >= puzzle_size_) {
                     num_processed++;
                     if (num_loaded < options_.test_dataset_size) {
-                        char *dest = &dataset_[puzzle_buf_size_ * num_loaded];
-                        strncpy(dest, line.c_str(), puzzle_size_);
-                        if (options_.randomize) util.PermuteSudoku(dest, options_.pencilmark);
+                        StorePuzzle(num_loaded, line.c_str());
                         num_loaded++;
                     } else if (util.RandomDouble() <
                                (double) options_.test_dataset_size / num_processed) {
                         auto replace = util.RandomUInt() % options_.test_dataset_size;
-                        char *dest = &dataset_[puzzle_buf_size_ * replace];
-                        strncpy(dest, line.c_str(), puzzle_size_);
-                        if (options_.randomize) util.PermuteSudoku(dest, options_.pencilmark);
+                        StorePuzzle(replace, line.c_str());
                     }
                 }
             } else if (line.find("ALLOWZERO") != string::npos) {
@@ -136,32 +416,99 @@ struct Benchmark {
         file.close();
 
         // if we've requested a test dataset at least as large as the input file, then fit as
-        // many full copies of the input file as we can.
+        // many full copies of the input file as we can, and then complete the dataset by
+        // sampling from loaded puzzles with uniform probability. every copy is of a puzzle as
+        // given, so the copies, like the transformations after them, are made in parallel.
+        size_t num_copied = num_loaded;
         if (num_loaded == num_processed) {
-            while (num_loaded + num_processed < options_.test_dataset_size) {
-                memcpy(&dataset_[puzzle_buf_size_ * num_loaded], &dataset_[0],
-                       puzzle_buf_size_ * num_processed);
-                if (options_.randomize) {
-                    for (int j = 0; j < num_processed; j++) {
-                        util.PermuteSudoku(&dataset_[puzzle_buf_size_ * (num_loaded + j)],
-                                options_.pencilmark);
-                    }
-                }
-                num_loaded += num_processed;
+            while (num_copied + num_processed < options_.test_dataset_size) {
+                num_copied += num_processed;
             }
         }
-        // then complete the dataset by sampling from loaded puzzles with uniform probability.
-        for (int i = num_loaded; i < options_.test_dataset_size; i++) {
-            auto which = util.RandomUInt() % num_loaded;
-            strncpy(&dataset_[puzzle_buf_size_ * i],
-                    &dataset_[puzzle_buf_size_ * which],
-                    puzzle_size_);
-            if (options_.randomize) {
-                util.PermuteSudoku(&dataset_[puzzle_buf_size_ * i], options_.pencilmark);
+        size_t num_given = num_loaded;
+        ForEachShard(options_.test_dataset_size, [&](size_t begin, size_t end, Util *rng) {
+            for (size_t i = max(begin, num_given); i < end; i++) {
+                size_t which = i < num_copied ? i % num_given : rng->RandomUInt() % num_given;
+                memcpy(&dataset_[puzzle_buf_size_ * i], &dataset_[puzzle_buf_size_ * which],
+                       puzzle_buf_size_);
             }
+        });
+        Transform(options_.test_dataset_size, options_.remove_clues);
+    }
+
+    void AllocateDataset() {
+        // freed first so that the old and new datasets are never both in memory.
+        dataset_.reset();
+        dataset_.reset(new char[options_.test_dataset_size * puzzle_buf_size_]);
+    }
+
+    // copies a puzzle to slot i of the dataset and zeroes the rest of the slot.
+    void StorePuzzle(size_t i, const char *puzzle) {
+        char *dest = &dataset_[puzzle_buf_size_ * i];
+        memcpy(dest, puzzle, puzzle_size_);
+        memset(dest + puzzle_size_, 0, puzzle_buf_size_ - puzzle_size_);
+    }
+
+    // puzzles per shard when preparing the dataset in parallel. each shard gets its own seed,
+    // drawn from util, so a dataset depends on the -e seed and not on the number of threads.
+    static constexpr size_t kShardSize = 4096;
+
+    // runs fn(begin, end, rng) for each shard [begin, end) of the first num_puzzles puzzles, on
+    // options_.load_threads threads.
+    template<class Fn>
+    void ForEachShard(size_t num_puzzles, Fn fn) {
+        uint64_t base_seed = util.RandomUInt();
+        base_seed = base_seed << 32u | util.RandomUInt();
+        size_t num_shards = (num_puzzles + kShardSize - 1) / kShardSize;
+        atomic<size_t> next_shard{0};
+        auto work = [&]() {
+            Util rng;
+            for (size_t shard = next_shard++; shard < num_shards; shard = next_shard++) {
+                rng.RandomSeed(base_seed + shard * 0x9e3779b97f4a7c15ull);
+                fn(shard * kShardSize, min(num_puzzles, (shard + 1) * kShardSize), &rng);
+            }
+        };
+        int num_threads = options_.load_threads > 0 ?
+                          options_.load_threads : (int) thread::hardware_concurrency();
+        num_threads = (int) min<size_t>((size_t) max(num_threads, 1), num_shards);
+        vector<thread> threads;
+        for (int i = 1; i < num_threads; i++) threads.emplace_back(work);
+        work();
+        for (thread &t : threads) t.join();
+    }
+
+    // randomly permutes (with -r) the first num_puzzles puzzles of the dataset and blanks out
+    // remove_clues clues in each.
+    void Transform(size_t num_puzzles, int remove_clues) {
+        if (!options_.randomize && remove_clues == 0) return;
+        ForEachShard(num_puzzles, [&](size_t begin, size_t end, Util *rng) {
+            for (size_t i = begin; i < end; i++) {
+                char *puzzle = &dataset_[puzzle_buf_size_ * i];
+                if (options_.randomize) rng->PermuteSudoku(puzzle, options_.pencilmark);
+                if (remove_clues > 0) RemoveClues(puzzle, remove_clues, rng);
+            }
+        });
+    }
+
+    // blank out remove_clues of the puzzle's clues, chosen at random.
+    static void RemoveClues(char *puzzle, int remove_clues, Util *rng) {
+        array<uint8_t, 81> clues{};
+        size_t num_clues = 0;
+        for (int i = 0; i < 81; i++) {
+            if (puzzle[i] != '.') clues[num_clues++] = (uint8_t) i;
+        }
+        for (int n = 0; n < remove_clues && num_clues > 0; n++) {
+            size_t which = rng->RandomUInt() % num_clues;
+            puzzle[clues[which]] = '.';
+            clues[which] = clues[--num_clues];
         }
     }
 
+    // the limit passed to solvers while benchmarking (warmup always stops at one solution).
+    size_t SolutionLimit() const {
+        return options_.first_solution ? 1 : options_.solution_limit;
+    }
+
     static bool ValidateSolution(const char *board) {
         array<uint32_t, 9 * 3> covered{};
         for (int i = 0; i < 9; i++) {
@@ -181,10 +528,21 @@ struct Benchmark {
         exit(1);
     }
 
+    // solves a puzzle during warmup (stopping at one solution), validating the result.
+    void WarmupSolve(const Solver &solver, const char *puzzle, char *output) {
+        size_t num_guesses;
+        output[0] = '.'; // make sure we won't validate a previous solution
+        size_t count = solver.Solve(puzzle, 1, output, &num_guesses);
+        if (!allow_zero_ &&
+            (!count || (options_.validate &&
+                        solver.ReturnsSolution() && !ValidateSolution(output)))) {
+            ExitError(puzzle, "warmup");
+        }
+    }
+
     // warm caches, branch predictor, etc. and estimate solving speed on this data.
     double WarmupAndEstimateRate(const Solver &solver) {
         char output[81]{0};
-        size_t num_guesses;
         int warmup_count = 0;
         microseconds start = duration_cast<microseconds>(steady_clock::now().time_since_epoch());
         microseconds end = start;
@@ -193,13 +551,7 @@ struct Benchmark {
             // the data set order is biased (e.g., easy or hard puzzles up front).
             const char *puzzle = &dataset_[puzzle_buf_size_ *
                                            (util.RandomUInt() % options_.test_dataset_size)];
-            output[0] = '.'; // make sure we won't validate a previous solution
-            size_t count = solver.Solve(puzzle, 1, output, &num_guesses);
-            if (!allow_zero_ &&
-                (!count || (options_.validate &&
-                            solver.ReturnsSolution() && !ValidateSolution(output)))) {
-                ExitError(puzzle, "warmup");
-            }
+            WarmupSolve(solver, puzzle, output);
             warmup_count++;
             end = duration_cast<microseconds>(steady_clock::now().time_since_epoch());
         }
@@ -207,6 +559,48 @@ struct Benchmark {
         return puzzles_per_second;
     }
 
+    static int BucketForGuesses(size_t guesses) {
+        if (guesses < 2) return (int) guesses;
+        if (guesses < 4) return 2;
+        if (guesses < 16) return 3;
+        return 4;
+    }
+
+    // assign every puzzle in the dataset to a difficulty bucket by the number of guesses the
+    // reference solver needs for it (with the same solution limit we'll benchmark with).
+    void Stratify(const string &dataset_filename) {
+        const Solver *reference = nullptr;
+        auto all_solvers = GetAllSolvers();
+        for (const Solver &s : all_solvers) {
+            if (s.Id() == options_.stratify_solver_id) reference = &s;
+        }
+        if (reference == nullptr || !reference->ReturnsGuessCount()) {
+            cout << "Stratification requires a reference solver that reports guess counts: "
+                 << options_.stratify_solver_id << endl;
+            exit(1);
+        }
+
+        char output[81]{0};
+        size_t num_guesses;
+        for (auto &bucket : buckets_) bucket.clear();
+        for (size_t i = 0; i < options_.test_dataset_size; i++) {
+            const char *puzzle = &dataset_[puzzle_buf_size_ * i];
+            reference->Solve(puzzle, SolutionLimit(), output, &num_guesses);
+            buckets_[BucketForGuesses(num_guesses)].push_back(i);
+        }
+
+        // the histogram goes first, as comment lines in csv mode so the rows stay parseable.
+        const char *prefix = options_.csv_output ? "# " : "";
+        cout << prefix << dataset_filename << ": difficulty by " << reference->Id()
+             << " guesses/puzzle" << endl;
+        for (int b = 0; b < kNumBuckets; b++) {
+            char str[256];
+            snprintf(str, sizeof(str), "%s  %-5s %10zu  %5.1f%%", prefix, kBucketLabels[b],
+                     buckets_[b].size(), 100.0 * buckets_[b].size() / options_.test_dataset_size);
+            cout << str << endl;
+        }
+    }
+
     void OutputHeader(const string &filename) {
         if (!options_.csv_output) {
             cout << endl << "|" << left << setw(37) << filename << " ";
@@ -224,7 +618,8 @@ struct Benchmark {
 
     void OutputResult(const Solver &solver, const string &dataset_filename,
                       size_t num_solved, double usec_total,
-                      size_t total_guesses, size_t total_no_guess) {
+                      size_t total_guesses, size_t total_no_guess,
+                      const char *bucket_label = nullptr) {
         setlocale(LC_NUMERIC, "");
         const char *f1 = "%.0s%.0s%.0s%.0s|%-27s%-11s|"
                          "%" COMMAS "12.1f |%" COMMAS "12.1f |%10.1f%% |%" COMMAS "15.2f |";
@@ -242,14 +637,61 @@ struct Benchmark {
         double percent_no_guess = 100 * total_no_guess / (double) num_solved;
         double guesses_per_puzzle = total_guesses / (double) num_solved;
 
+        // per-bucket rows are tagged by suffixing the solver id, e.g. "tdoku/triad_scc [2-3]".
+        string id = solver.Id();
+        if (bucket_label != nullptr) id += string(" [") + bucket_label + "]";
+
         char str[1024];
         snprintf(str, sizeof(str), fmt,
                 CXX_COMPILER_ID, CXX_COMPILER_VERSION, CXX_FLAGS,
-                dataset_filename.c_str(), solver.Id().c_str(), solver.Desc().c_str(),
+                dataset_filename.c_str(), id.c_str(), solver.Desc().c_str(),
                 puzzles_per_second, usec_per_puzzle, percent_no_guess, guesses_per_puzzle);
         cout << str << endl;
     }
 
+    // time the solver on one difficulty bucket, making full passes over the bucket until the
+    // time budget is spent (but always at least one pass). like the full dataset, the bucket is
+    // first solved and validated for warmup_usec, so the branch predictor has learned this
+    // bucket's puzzles rather than the previous one's.
+    void TestBucket(const Solver &solver, const string &filename, int bucket,
+                    int64_t warmup_usec, int64_t min_usec) {
+        const vector<size_t> &indices = buckets_[bucket];
+        if (indices.empty()) return;
+
+        char puzzle_output[81]{0};
+        size_t puzzle_guesses;
+        size_t total_guesses = 0;
+        size_t total_no_guess = 0;
+        size_t total_solved = 0;
+
+        microseconds start = duration_cast<microseconds>(steady_clock::now().time_since_epoch());
+        microseconds end = start;
+        for (size_t i = 0; (end - start).count() < warmup_usec; i++) {
+            WarmupSolve(solver, &dataset_[puzzle_buf_size_ * indices[i % indices.size()]],
+                        puzzle_output);
+            end = duration_cast<microseconds>(steady_clock::now().time_since_epoch());
+        }
+
+        start = end = duration_cast<microseconds>(steady_clock::now().time_since_epoch());
+        do {
+            for (size_t i : indices) {
+                const char *puzzle = &dataset_[puzzle_buf_size_ * i];
+                size_t solutions = solver.Solve(puzzle, SolutionLimit(),
+                                                puzzle_output, &puzzle_guesses);
+                if (!allow_zero_ && !solutions) {
+                    ExitError(puzzle, "benchmark");
+                }
+                total_guesses += puzzle_guesses;
+                total_no_guess += (puzzle_guesses == 0);
+            }
+            total_solved += indices.size();
+            end = duration_cast<microseconds>(steady_clock::now().time_since_epoch());
+        } while ((end - start).count() < min_usec);
+
+        OutputResult(solver, filename, total_solved, (end - start).count(),
+                     total_guesses, total_no_guess, kBucketLabels[bucket]);
+    }
+
     // we'll preload and permute the puzzles in each dataset before running each solver against
     // it. for each solver we'll run for a warmup period before measurement both to warm caches,
     // branch prediction, etc., and to estimate runtime. there's a lot of variance in runtime.
@@ -261,10 +703,13 @@ struct Benchmark {
             util.RandomSeed(options_.random_seed);
         }
         Load(filename);
+        bool stratify = !options_.stratify_solver_id.empty();
+        if (stratify) Stratify(filename);
         OutputHeader(filename);
 
         // for the slow solvers we'll solve puzzles in this order to avoid any difficulty biases.
         auto perm = util.Permutation(options_.test_dataset_size);
+        measurements_.clear();
 
         for (const Solver &solver : options_.solvers) {
             double puzzles_per_second = WarmupAndEstimateRate(solver);
@@ -286,7 +731,7 @@ struct Benchmark {
                 while ((end - start).count() < options_.min_seconds_test * 1000000) {
                     for (int i = 0; i < options_.test_dataset_size; i++) {
                         const char *puzzle = &dataset_[puzzle_buf_size_ * i];
-                        size_t solutions = solver.Solve(puzzle, options_.first_solution ? 1 : 2,
+                        size_t solutions = solver.Solve(puzzle, SolutionLimit(),
                                                         puzzle_output, &puzzle_guesses);
                         if (!allow_zero_ && !solutions) {
                             ExitError(puzzle, "benchmark");
@@ -300,7 +745,7 @@ struct Benchmark {
             } else {
                 while ((end - start).count() < options_.min_seconds_test * 2000000) {
                     const char *puzzle = &dataset_[puzzle_buf_size_ * perm[total_solved % options_.test_dataset_size]];
-                    size_t solutions = solver.Solve(puzzle, options_.first_solution ? 1 : 2,
+                    size_t solutions = solver.Solve(puzzle, SolutionLimit(),
                                                     puzzle_output, &puzzle_guesses);
                     if (!allow_zero_ && !solutions) {
                         ExitError(puzzle, "benchmark");
@@ -314,21 +759,273 @@ struct Benchmark {
 
             auto total_usec = (end - start).count();
             OutputResult(solver, filename, total_solved, total_usec, total_guesses, total_no_guess);
+            if (solver.ReturnsGuessCount()) {
+                measurements_.push_back({solver.Id(), total_usec / (double) total_solved,
+                                         total_guesses / (double) total_solved});
+            }
+
+            // then split the warmup and test times among the non-empty buckets.
+            if (stratify) {
+                int num_nonempty = 0;
+                for (const auto &bucket : buckets_) num_nonempty += !bucket.empty();
+                int64_t warmup_usec = options_.min_seconds_warmup * 1000000LL / num_nonempty;
+                int64_t bucket_usec = options_.min_seconds_test * 1000000LL / num_nonempty;
+                for (int b = 0; b < kNumBuckets; b++) {
+                    TestBucket(solver, filename, b, warmup_usec, bucket_usec);
+                }
+            }
+        }
+        if (options_.Sweep()) OutputPareto(filename);
+    }
+
+    // the solvers no other beats on both time and guesses per puzzle, fastest first. in csv
+    // mode these are comment lines, so the rows above stay parseable. solvers that don't count
+    // guesses are left out.
+    void OutputPareto(const string &filename) {
+        vector<Measurement> sorted = measurements_;
+        sort(sorted.begin(), sorted.end(), [](const Measurement &a, const Measurement &b) {
+            return a.usec_per_puzzle != b.usec_per_puzzle ?
+                   a.usec_per_puzzle < b.usec_per_puzzle :
+                   a.guesses_per_puzzle < b.guesses_per_puzzle;
+        });
+        const char *prefix = options_.csv_output ? "# " : "";
+        cout << endl << prefix << filename << ": pareto front of usec/puzzle vs. guesses/puzzle"
+             << endl;
+        double fewest_guesses = INFINITY;
+        for (const Measurement &m : sorted) {
+            if (m.guesses_per_puzzle >= fewest_guesses) continue;
+            fewest_guesses = m.guesses_per_puzzle;
+            char str[256];
+            snprintf(str, sizeof(str), "%s  %-38s %12.1f %15.2f", prefix, m.id.c_str(),
+                     m.usec_per_puzzle, m.guesses_per_puzzle);
+            cout << str << endl;
+        }
+    }
+
+    // a worker of the throughput test: the core it runs on, its shard of the dataset, and what
+    // it measured for the current solver.
+    struct ThroughputWorker {
+        int core = 0;
+        size_t num_puzzles = 0;
+        unique_ptr<ShardMemory> shard{};
+        size_t num_solved = 0;
+        size_t total_guesses = 0;
+        size_t total_no_guess = 0;
+        int64_t usec = 0;
+    };
+
+    // runs fn(worker) for each of the first num_workers workers on its own thread, pinned to
+    // the worker's core.
+    template<class Fn>
+    static void OnWorkerCores(vector<ThroughputWorker> &workers, size_t num_workers, Fn fn) {
+        vector<thread> threads;
+        for (size_t w = 0; w < num_workers; w++) {
+            ThroughputWorker &worker = workers[w];
+            threads.emplace_back([&fn, &worker]() {
+                PinToCpu(worker.core);
+                fn(worker);
+            });
+        }
+        for (thread &t : threads) t.join();
+    }
+
+    // warms up on the worker's shard like WarmupAndEstimateRate, waits at the barrier for the
+    // other num_workers - 1, then solves its shard round and round for the test time.
+    void SolveShard(const Solver &solver, ThroughputWorker &worker, size_t num_workers,
+                    atomic<size_t> *barrier) {
+        char output[81]{0};
+        size_t num_guesses;
+        auto shard_puzzle = [&](size_t i) {
+            return worker.shard->Data() + puzzle_buf_size_ * (i % worker.num_puzzles);
+        };
+        microseconds start = duration_cast<microseconds>(steady_clock::now().time_since_epoch());
+        microseconds end = start;
+        for (size_t i = 0; (end - start).count() < options_.min_seconds_warmup * 1000000; i++) {
+            WarmupSolve(solver, shard_puzzle(i), output);
+            end = duration_cast<microseconds>(steady_clock::now().time_since_epoch());
+        }
+        (*barrier)++;
+        while (*barrier < num_workers) this_thread::yield();
+
+        worker.num_solved = worker.total_guesses = worker.total_no_guess = 0;
+        start = end = duration_cast<microseconds>(steady_clock::now().time_since_epoch());
+        while ((end - start).count() < options_.min_seconds_test * 1000000) {
+            // the clock is read every 64 puzzles, a pass over the shard or not.
+            for (int n = 0; n < 64; n++) {
+                const char *puzzle = shard_puzzle(worker.num_solved++);
+                size_t solutions = solver.Solve(puzzle, SolutionLimit(), output, &num_guesses);
+                if (!allow_zero_ && !solutions) {
+                    ExitError(puzzle, "benchmark");
+                }
+                worker.total_guesses += num_guesses;
+                worker.total_no_guess += (num_guesses == 0);
+            }
+            end = duration_cast<microseconds>(steady_clock::now().time_since_epoch());
+        }
+        worker.usec = (end - start).count();
+    }
+
+    // measures each solver's throughput with a worker pinned to each of the -o cores, solving
+    // its own shard of the dataset at the same time as the others. each worker allocates and
+    // fills its shard (on huge pages with -y), so with the kernel's default first-touch policy
+    // the shard is local to the worker's NUMA node. rows follow for each core (tagged with the
+    // node its shard's memory is on), each node (by its cores) and the total; the usec/puzzle
+    // of the summed rows is wall time over all their workers. solvers that aren't ThreadSafe
+    // run on the first worker only.
+    void TestThroughput(const string &filename) {
+        if (options_.random_seed > 0) {
+            util.RandomSeed(options_.random_seed);
+        }
+        size_t num_workers = options_.worker_cores.size();
+        if (num_workers > options_.test_dataset_size) {
+            cout << "More -o cores than puzzles in the dataset" << endl;
+            exit(1);
+        }
+        Load(filename);
+        vector<ThroughputWorker> workers(num_workers);
+        for (size_t w = 0; w < num_workers; w++) {
+            workers[w].core = options_.worker_cores[w];
+            workers[w].num_puzzles = options_.test_dataset_size * (w + 1) / num_workers -
+                                     options_.test_dataset_size * w / num_workers;
+        }
+        OnWorkerCores(workers, num_workers, [&](ThroughputWorker &worker) {
+            size_t w = &worker - &workers[0];
+            size_t bytes = worker.num_puzzles * puzzle_buf_size_;
+            worker.shard.reset(new ShardMemory(bytes, options_.huge_pages));
+            memcpy(worker.shard->Data(),
+                   &dataset_[puzzle_buf_size_ * (options_.test_dataset_size * w / num_workers)], bytes);
+        });
+        // the shards are all the workers read, so the main thread's copy can go.
+        dataset_.reset();
+        OutputHeader(filename);
+
+        for (const Solver &solver : options_.solvers) {
+            size_t num_active = num_workers;
+            if (num_active > 1 && !SolversThreadSafe({solver}, "its throughput test")) {
+                num_active = 1;
+            }
+            atomic<size_t> barrier{0};
+            OnWorkerCores(workers, num_active, [&](ThroughputWorker &worker) {
+                SolveShard(solver, worker, num_active, &barrier);
+            });
+
+            // summed rows: by node of each core, then over all workers.
+            struct Sum {
+                size_t num_solved = 0, total_guesses = 0, total_no_guess = 0;
+                double puzzles_per_usec = 0.0;
+            };
+            map<int, Sum> node_sums;
+            Sum total;
+            for (size_t w = 0; w < num_active; w++) {
+                const ThroughputWorker &worker = workers[w];
+                int memory_node = worker.shard->Node();
+                string label = "cpu" + to_string(worker.core) + " mem" +
+                               (memory_node < 0 ? string("?") : to_string(memory_node));
+                OutputResult(solver, filename, worker.num_solved, (double) worker.usec,
+                             worker.total_guesses, worker.total_no_guess, label.c_str());
+                for (Sum *sum : {&node_sums[NodeOfCpu(worker.core)], &total}) {
+                    sum->num_solved += worker.num_solved;
+                    sum->total_guesses += worker.total_guesses;
+                    sum->total_no_guess += worker.total_no_guess;
+                    sum->puzzles_per_usec += worker.num_solved / (double) worker.usec;
+                }
+            }
+            for (const auto &node_sum : node_sums) {
+                const Sum &sum = node_sum.second;
+                string label = "node" + to_string(node_sum.first);
+                OutputResult(solver, filename, sum.num_solved, sum.num_solved / sum.puzzles_per_usec,
+                             sum.total_guesses, sum.total_no_guess, label.c_str());
+            }
+            OutputResult(solver, filename, total.num_solved, total.num_solved / total.puzzles_per_usec,
+                         total.total_guesses, total.total_no_guess);
+        }
+    }
+
+    // solve each puzzle in the dataset once with the drake library under the -g/-m budget, and
+    // report how many exceed it, along with the guesses and time of the rest.
+    void CheckBudget(const string &filename) {
+        if (options_.random_seed > 0) {
+            util.RandomSeed(options_.random_seed);
+        }
+        Load(filename);
+        DrakeBudget budget{options_.budget_guesses, options_.budget_usec};
+        DrakeResult result;
+        // the thread's first call sets up its solver, which no budget covers, so that's done
+        // before any call is timed.
+        char solution[81];
+        size_t warmup_guesses;
+        DrakeSolveSudoku(&dataset_[0], 1, 3, solution, &warmup_guesses);
+        size_t num_exceeded = 0, total_guesses = 0, max_guesses = 0;
+        int64_t usec_total = 0, max_usec = 0;
+        for (size_t i = 0; i < options_.test_dataset_size; i++) {
+            const char *puzzle = &dataset_[puzzle_buf_size_ * i];
+            microseconds start = duration_cast<microseconds>(steady_clock::now().time_since_epoch());
+            DrakeStatus status = DrakeSolveSudokuWithBudget(puzzle, SolutionLimit(), 3, &budget,
+                                                            &result, nullptr);
+            microseconds end = duration_cast<microseconds>(steady_clock::now().time_since_epoch());
+            if (status == DRAKE_BUDGET_EXHAUSTED) {
+                num_exceeded++;
+                continue;
+            }
+            if (!allow_zero_ && !result.num_solutions) {
+                ExitError(puzzle, "budget");
+            }
+            int64_t usec = (end - start).count();
+            usec_total += usec;
+            max_usec = max(max_usec, usec);
+            total_guesses += result.num_guesses;
+            max_guesses = max(max_guesses, result.num_guesses);
+        }
+        size_t num_completed = options_.test_dataset_size - num_exceeded;
+        double percent_exceeded = 100.0 * num_exceeded / options_.test_dataset_size;
+        double usec_per_puzzle = num_completed ? usec_total / (double) num_completed : 0.0;
+        double guesses_per_puzzle = num_completed ? total_guesses / (double) num_completed : 0.0;
+        string budget_guesses = options_.budget_guesses == DRAKE_NO_GUESS_LIMIT ?
+                                "none" : to_string(options_.budget_guesses);
+        string budget_usec = options_.budget_usec == DRAKE_NO_TIME_LIMIT ?
+                             "none" : to_string(options_.budget_usec);
+        char str[1024];
+        if (options_.csv_output) {
+            snprintf(str, sizeof(str), "%s,%s,%s,%s,%s,%s,%zu,%zu,%f,%f,%f,%zu,%lld",
+                     CXX_COMPILER_ID, CXX_COMPILER_VERSION, CXX_FLAGS, filename.c_str(),
+                     budget_guesses.c_str(), budget_usec.c_str(),
+                     options_.test_dataset_size, num_exceeded, percent_exceeded,
+                     usec_per_puzzle, guesses_per_puzzle, max_guesses, (long long) max_usec);
+        } else {
+            cout << endl << "|" << left << setw(37) << filename << " ";
+            cout << "|  budget guesses|   budget usec|    puzzles|   exceeded|  %exceeded|" << endl;
+            cout << "|--------------------------------------"
+                    "|---------------:|-------------:|----------:|----------:|----------:|" << endl;
+            snprintf(str, sizeof(str), "|%-38s|%15s |%13s |%10zu |%10zu |%9.2f%% |\n"
+                     "within budget: %.1f usec/puzzle, %.2f guesses/puzzle, at most %zu guesses "
+                     "and %lld usec", "drake/lib", budget_guesses.c_str(),
+                     budget_usec.c_str(), options_.test_dataset_size,
+                     num_exceeded, percent_exceeded, usec_per_puzzle, guesses_per_puzzle, max_guesses,
+                     (long long) max_usec);
         }
+        cout << str << endl;
     }
 
+    // puzzles per block when rating. each worker rates a block at a time, with permutations
+    // seeded per block, so the ratings (by backtracks) don't depend on the number of threads.
+    static constexpr size_t kRateBlockSize = 64;
+
+    // rates each puzzle in the file by the average time (or backtracks, with -b) each solver
+    // takes over test_dataset_size random permutations of it. the puzzles are rated a block at
+    // a time on -i threads, each pinned to its own core where supported so that its timings are
+    // its own, with per-thread solvers and permutation buffers. rows are written in input
+    // order as their blocks complete.
     void Rate(const string &dataset_filename) {
+        if (options_.random_seed > 0) {
+            util.RandomSeed(options_.random_seed);
+        }
         ifstream file;
         file.open(dataset_filename);
         if (file.fail()) {
             cout << "Error opening " << dataset_filename << endl;
             exit(1);
         }
-        dataset_.resize(options_.test_dataset_size * puzzle_buf_size_);
-        fill(dataset_.begin(), dataset_.end(), 0);
-
-        char solution[81];
-        size_t guesses = 0;
+        vector<char> puzzles;
         string line;
         while (getline(file, line)) {
             if (line.length() > 0 && line[0] != '#') {
@@ -336,32 +1033,82 @@ struct Benchmark {
                     line.erase(line.size() - 1);
                 }
                 if (line.length() >= puzzle_size_) {
-                    for (int i = 0; i < options_.test_dataset_size; i++) {
-                        char *dest = &dataset_[i * puzzle_buf_size_];
-                        strncpy(dest, line.c_str(), puzzle_size_);
-                        if (options_.randomize) {
-                            util.PermuteSudoku(dest, options_.pencilmark);
-                        }
+                    puzzles.insert(puzzles.end(), line.begin(), line.begin() + puzzle_size_);
+                }
+            }
+        }
+        file.close();
+
+        size_t num_puzzles = puzzles.size() / puzzle_size_;
+        size_t num_solvers = options_.solvers.size();
+        size_t num_blocks = (num_puzzles + kRateBlockSize - 1) / kRateBlockSize;
+        vector<double> costs(num_puzzles * num_solvers);
+        vector<char> block_done(num_blocks);
+        mutex done_mutex;
+        condition_variable block_completed;
+        atomic<size_t> next_block{0};
+        uint64_t base_seed = util.RandomUInt();
+        base_seed = base_seed << 32u | util.RandomUInt();
+
+        vector<int> cpus = AvailableCpus();
+        auto work = [&](int worker) {
+            PinToCore(worker, cpus);
+            Util rng;
+            unique_ptr<char[]> copies(new char[options_.test_dataset_size * puzzle_buf_size_]);
+            char solution[81];
+            size_t guesses = 0;
+            for (size_t block = next_block++; block < num_blocks; block = next_block++) {
+                rng.RandomSeed(base_seed + block * 0x9e3779b97f4a7c15ull);
+                size_t end = min(num_puzzles, (block + 1) * kRateBlockSize);
+                for (size_t p = block * kRateBlockSize; p < end; p++) {
+                    for (size_t i = 0; i < options_.test_dataset_size; i++) {
+                        char *copy = &copies[i * puzzle_buf_size_];
+                        memcpy(copy, &puzzles[p * puzzle_size_], puzzle_size_);
+                        memset(copy + puzzle_size_, 0, puzzle_buf_size_ - puzzle_size_);
+                        if (options_.randomize) rng.PermuteSudoku(copy, options_.pencilmark);
                     }
-                    for (const Solver &solver : options_.solvers) {
+                    for (size_t s = 0; s < num_solvers; s++) {
+                        const Solver &solver = options_.solvers[s];
                         microseconds start =
                                 duration_cast<microseconds>(steady_clock::now().time_since_epoch());
                         double total_guesses = 0.0;
-                        for (int i = 0; i < options_.test_dataset_size; i++) {
-                            const char *puzzle = &dataset_[i * puzzle_buf_size_];
-                            solver.Solve(puzzle, 1, solution, &guesses);
+                        for (size_t i = 0; i < options_.test_dataset_size; i++) {
+                            solver.Solve(&copies[i * puzzle_buf_size_], 1, solution, &guesses);
                             total_guesses += guesses;
                         }
-                        microseconds end =
+                        microseconds end_time =
                                 duration_cast<microseconds>(steady_clock::now().time_since_epoch());
                         double cost = (options_.rate_by_backtracks ?
-                                total_guesses : (double)(end - start).count());
-                        printf("%12.1f\t", cost / options_.test_dataset_size);
+                                total_guesses : (double) (end_time - start).count());
+                        costs[p * num_solvers + s] = cost / options_.test_dataset_size;
                     }
-                    cout << endl;
                 }
+                lock_guard<mutex> lock(done_mutex);
+                block_done[block] = 1;
+                block_completed.notify_one();
+            }
+        };
+
+        int num_threads = options_.rate_threads > 0 ? options_.rate_threads : (int) cpus.size();
+        if (num_threads > 1 && !SolversThreadSafe(options_.solvers, "rating")) num_threads = 1;
+        num_threads = (int) min<size_t>((size_t) max(num_threads, 1), max<size_t>(num_blocks, 1));
+        vector<thread> threads;
+        for (int i = 0; i < num_threads; i++) threads.emplace_back(work, i);
+        for (size_t block = 0; block < num_blocks; block++) {
+            {
+                unique_lock<mutex> lock(done_mutex);
+                block_completed.wait(lock, [&]() { return block_done[block] != 0; });
             }
+            size_t end = min(num_puzzles, (block + 1) * kRateBlockSize);
+            for (size_t p = block * kRateBlockSize; p < end; p++) {
+                for (size_t s = 0; s < num_solvers; s++) {
+                    printf("%12.1f\t", costs[p * num_solvers + s]);
+                }
+                printf("\n");
+            }
+            fflush(stdout);
         }
+        for (thread &t : threads) t.join();
     }
 };
 
@@ -374,7 +1121,7 @@ int main(int argc, char **argv) {
     bool do_rating = false;
     ketopt_t opt = KETOPT_INIT;
     char c;
-    while ((c = (char)ketopt(&opt, argc, argv, 1, "abc::e:fhn:pr::s:t:v::w:z::", nullptr)) != -1) {
+    while ((c = (char)ketopt(&opt, argc, argv, 1, "abc::d:e:fg:hi:j:k:l:m:n:o:pq:r::s:t:u:v::w:xy::z::", nullptr)) != -1) {
         switch (c) {
             case 'a': {
                 do_rating = true;
@@ -388,6 +1135,10 @@ int main(int argc, char **argv) {
                 options.csv_output = opt.arg == nullptr ? true : stoi(opt.arg) > 0;
                 break;
             }
+            case 'd': {
+                options.stratify_solver_id = opt.arg;
+                break;
+            }
             case 'e': {
                 options.random_seed = stoull(opt.arg);
                 break;
@@ -396,14 +1147,46 @@ int main(int argc, char **argv) {
                 options.first_solution = true;
                 break;
             }
+            case 'g': {
+                options.budget_guesses = (size_t) stoull(opt.arg);
+                break;
+            }
+            case 'i': {
+                options.rate_threads = stoi(opt.arg);
+                break;
+            }
+            case 'j': {
+                options.load_threads = stoi(opt.arg);
+                break;
+            }
+            case 'k': {
+                options.sweep_configurations = ParseValues(opt.arg);
+                break;
+            }
+            case 'l': {
+                options.solution_limit = (size_t) stoull(opt.arg);
+                break;
+            }
+            case 'm': {
+                options.budget_usec = (uint64_t) stoull(opt.arg);
+                break;
+            }
             case 'n': {
                 options.test_dataset_size = (size_t) stoi(opt.arg);
                 break;
             }
+            case 'o': {
+                options.worker_cores = ParseCores(opt.arg);
+                break;
+            }
             case 'p': {
                 options.pencilmark = true;
                 break;
             }
+            case 'q': {
+                options.sweep_threads = ParseValues(opt.arg);
+                break;
+            }
             case 'r': {
                 options.randomize = opt.arg == nullptr ? true : stoi(opt.arg) > 0;
                 break;
@@ -426,6 +1209,10 @@ int main(int argc, char **argv) {
                 options.min_seconds_test = stoi(opt.arg);
                 break;
             }
+            case 'u': {
+                options.remove_clues = stoi(opt.arg);
+                break;
+            }
             case 'v': {
                 options.validate = opt.arg == nullptr ? true : stoi(opt.arg) > 0;
                 break;
@@ -434,6 +1221,14 @@ int main(int argc, char **argv) {
                 options.min_seconds_warmup = stoi(opt.arg);
                 break;
             }
+            case 'x': {
+                options.isa_variants = true;
+                break;
+            }
+            case 'y': {
+                options.huge_pages = opt.arg == nullptr ? 1 : stoi(opt.arg);
+                break;
+            }
             case 'h':
             default: {
                 cout << "usage: run_benchmark <options> puzzle_file_1 [...] " << endl;
@@ -441,37 +1236,81 @@ int main(int argc, char **argv) {
                 cout << "  -a                  // do rating" << endl;
                 cout << "  -b                  // rate by backtracks" << endl;
                 cout << "  -c [0|1]            // output csv instead of table [default 0]" << endl;
+                cout << "  -d <solver>         // also report by difficulty (guesses by this solver)" << endl;
                 cout << "  -e <seed>           // random seed [default random_device{}()]" << endl;
+                cout << "  -g <guesses>        // count puzzles exceeding a guess budget, 0 for any guess (drake/lib)" << endl;
                 cout << "  -h                  // display this help message" << endl;
+                cout << "  -i <threads>        // threads for rating, 0 for all cores [default 1]" << endl;
+                cout << "  -j <threads>        // threads for preparing datasets [default all cores]" << endl;
+                cout << "  -k <configs>        // sweep solver configurations, e.g. 0-3,7,11" << endl;
+                cout << "  -l <limit>          // solution limit unless -f [default 2]" << endl;
+                cout << "  -m <usec>           // count puzzles exceeding a time budget (drake/lib)" << endl;
                 cout << "  -n <size>           // test set size [default 2500000]" << endl;
+                cout << "  -o <cores>          // throughput of pinned workers on cores 0-3,8 or compact[:n], spread[:n]" << endl;
                 cout << "  -p                  // expect 729 character pencilmark sudoku" << endl;
+                cout << "  -q <threads>        // sweep thread counts (solvers that take one), e.g. 1-4,8" << endl;
                 cout << "  -r [0|1]            // randomly permute puzzles [default 1]" << endl;
                 cout << "  -s solver_1,...     // which solvers to run [default all]" << endl;
                 cout << "  -t <secs>           // target test time [default 20]" << endl;
+                cout << "  -u <clues>          // blank out this many clues per puzzle [default 0]" << endl;
                 cout << "  -v [0|1]            // validate during warmup [default 1]" << endl;
                 cout << "  -w <secs>           // target warmup time [default 10]" << endl;
+                cout << "  -x                  // run tdoku once per ISA build this host supports" << endl;
+                cout << "  -y [0|1|2]          // huge pages for -o shards: none, transparent, explicit [default 0]" << endl;
                 cout << "solvers: " << endl;
                 for (auto &solver : GetAllSolvers()) {
                     cout << " " << solver.Id();
                 }
                 cout << "\nbuild info: "
                      << CXX_COMPILER_ID << " " << CXX_COMPILER_VERSION << CXX_FLAGS << endl;
+                cout << "tdoku isa: " << TdokuSelectedIsa() << " (of";
+                for (size_t i = 0; i < TdokuNumIsaVariants(); i++) {
+                    cout << " " << TdokuIsaVariantName(i);
+                }
+                cout << ")" << endl;
                 exit(0);
             }
         }
     }
 
-    Benchmark benchmark(options);
+    if (options.remove_clues > 0 && options.pencilmark) {
+        cout << "-u applies to vanilla sudoku only" << endl;
+        exit(1);
+    }
 
-    if (opt.ind == argc) {
-        benchmark.Test("data/puzzles1_unbiased");
-    } else {
-        for (int i = opt.ind; i < argc; i++) {
-            if (do_rating) {
-                benchmark.Rate(argv[i]);
+    if (options.isa_variants) {
+        // substitute the ISA builds for "tdoku" where it was requested, or add them.
+        vector<Solver> solvers;
+        bool substituted = false;
+        for (const Solver &solver : options.solvers) {
+            if (solver.Id() == "tdoku") {
+                for (const Solver &variant : GetIsaVariantSolvers()) solvers.push_back(variant);
+                substituted = true;
             } else {
-                benchmark.Test(argv[i]);
+                solvers.push_back(solver);
             }
         }
+        if (!substituted) {
+            for (const Solver &variant : GetIsaVariantSolvers()) solvers.push_back(variant);
+        }
+        options.solvers = solvers;
+    }
+
+    if (options.Sweep()) options.solvers = SweepSolvers(options);
+
+    Benchmark benchmark(options);
+
+    vector<string> filenames(argv + opt.ind, argv + argc);
+    if (filenames.empty()) filenames.emplace_back("data/puzzles1_unbiased");
+    for (const string &filename : filenames) {
+        if (options.Budgeted()) {
+            benchmark.CheckBudget(filename);
+        } else if (do_rating) {
+            benchmark.Rate(filename);
+        } else if (!options.worker_cores.empty()) {
+            benchmark.TestThroughput(filename);
+        } else {
+            benchmark.Test(filename);
+        }
     }
 }
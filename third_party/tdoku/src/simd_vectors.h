@@ -1,6 +1,12 @@
 #ifndef TDOKU_SIMD_VECTORS_H
 #define TDOKU_SIMD_VECTORS_H
 
+// hand-written x86 intrinsics below, or a portable backend built on compiler vector extensions
+// on other targets and on request (cmake -DGENERIC_SIMD=ON defines TDOKU_GENERIC_SIMD).
+#if (defined TDOKU_GENERIC_SIMD || !(defined __x86_64__ || defined __i386__))
+#include "simd_vectors_generic.h"
+#else
+
 #include <cstring>
 #include <immintrin.h>
 #include <memory>
@@ -877,4 +883,6 @@ inline uint64_t WhichDots64(const char *x) {
 
 #pragma GCC diagnostic pop
 
+#endif // TDOKU_GENERIC_SIMD
+
 #endif //TDOKU_SIMD_VECTORS_H
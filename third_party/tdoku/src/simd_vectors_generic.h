@@ -0,0 +1,487 @@
+#ifndef TDOKU_SIMD_VECTORS_GENERIC_H
+#define TDOKU_SIMD_VECTORS_GENERIC_H
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <tuple>
+#include <utility>
+
+#if (defined __ARM_NEON && defined __aarch64__)
+#include <arm_neon.h>
+#endif
+
+/*
+ * Portable implementation of the Bitvec08x16 and Bitvec16x16 interfaces from simd_vectors.h
+ * using GCC/Clang vector extensions (__attribute__((vector_size))) for the lane-wise
+ * operations and scalar loops where there's no portable equivalent (e.g., minpos). The
+ * compiler lowers the vector types to whatever the target offers (NEON, SSE, AVX2) or to
+ * scalar code.
+ *
+ * This is selected automatically on non-x86 targets, and can be selected on x86 with
+ * -DGENERIC_SIMD=ON to compare against the hand-written intrinsics on the same machine.
+ *
+ * Semantics follow the x86 versions exactly, including the signed 16-bit comparisons in
+ * WhichNonZero and AnyLessThan, pshufb's zeroing of bytes whose control has the high bit
+ * set, and shuffles operating within each 128-bit half of a Bitvec16x16.
+ */
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wreturn-type"
+
+struct TwoBy64 {
+    uint64_t x0;
+    uint64_t x1;
+};
+
+struct FourBy64 {
+    uint64_t x0;
+    uint64_t x1;
+    uint64_t x2;
+    uint64_t x3;
+};
+
+typedef uint8_t U8x16 __attribute__((vector_size(16)));
+typedef uint8_t U8x32 __attribute__((vector_size(32)));
+typedef uint16_t U16x8 __attribute__((vector_size(16)));
+typedef int16_t I16x8 __attribute__((vector_size(16)));
+typedef uint16_t U16x16 __attribute__((vector_size(32)));
+typedef int16_t I16x16 __attribute__((vector_size(32)));
+typedef uint64_t U64x2 __attribute__((vector_size(16)));
+
+// constant lane permutations. __builtin_shufflevector also lets us split and join vectors
+// without a round trip through memory; gcc only has it from version 12.
+#if (defined __clang__ || __GNUC__ >= 12)
+#define TDOKU_HAVE_SHUFFLEVECTOR
+#define TDOKU_PERMUTE16x8(v, ...) __builtin_shufflevector(v, v, __VA_ARGS__)
+#define TDOKU_PERMUTE16x16(v, ...) __builtin_shufflevector(v, v, __VA_ARGS__)
+#else
+#define TDOKU_PERMUTE16x8(v, ...) __builtin_shuffle(v, (U16x8){__VA_ARGS__})
+#define TDOKU_PERMUTE16x16(v, ...) __builtin_shuffle(v, (U16x16){__VA_ARGS__})
+#endif
+
+namespace {
+
+// pshufb: each output byte is the input byte selected by the low 4 bits of the control byte,
+// or zero if the control byte's high bit is set.
+inline U8x16 ShuffleBytes(const U8x16 &x, const U8x16 &control) {
+#if (defined __ARM_NEON && defined __aarch64__)
+    // tbl zeroes lanes whose index is out of range, so keeping the high bit does the rest.
+    return (U8x16) vqtbl1q_u8((uint8x16_t) x, (uint8x16_t) (control & 0x8f));
+#elif (defined __GNUC__ && !defined __clang__)
+    U8x16 shuffled = __builtin_shuffle(x, control & 0x0f);
+    return shuffled & (U8x16) ((control & 0x80) == 0);
+#else
+    U8x16 out;
+    for (int i = 0; i < 16; i++) {
+        out[i] = (control[i] & 0x80u) ? 0 : x[control[i] & 0x0fu];
+    }
+    return out;
+#endif
+}
+
+// pshufb on each 128-bit half.
+inline U8x32 ShuffleBytesInHalves(const U8x32 &x, const U8x32 &control) {
+#if (defined __GNUC__ && !defined __clang__)
+    const U8x32 half_offsets{0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                             16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16};
+    U8x32 shuffled = __builtin_shuffle(x, (control & 0x0f) | half_offsets);
+    return shuffled & (U8x32) ((control & 0x80) == 0);
+#else
+    U8x16 x_lo, x_hi, control_lo, control_hi;
+    memcpy(&x_lo, &x, 16);
+    memcpy(&x_hi, (const char *) &x + 16, 16);
+    memcpy(&control_lo, &control, 16);
+    memcpy(&control_hi, (const char *) &control + 16, 16);
+    U8x16 lo = ShuffleBytes(x_lo, control_lo), hi = ShuffleBytes(x_hi, control_hi);
+    U8x32 out;
+    memcpy(&out, &lo, 16);
+    memcpy((char *) &out + 16, &hi, 16);
+    return out;
+#endif
+}
+
+// counts the bits set in each 16-bit lane.
+template<class V>
+inline V LanePopcounts(V x) {
+    x = x - ((x >> 1) & 0x5555);
+    x = (x & 0x3333) + ((x >> 2) & 0x3333);
+    x = (x + (x >> 4)) & 0x0f0f;
+    return (x + (x >> 8)) & 0x00ff;
+}
+
+} // namespace
+
+struct Bitvec08x16 {
+    U16x8 vec;
+
+    Bitvec08x16() : vec{} {}
+
+    // non-explicit conversions intended
+    Bitvec08x16(const U16x8 &u16x8) noexcept : vec{u16x8} {}
+
+    Bitvec08x16(const Bitvec08x16 &other) noexcept : vec(other.vec) {}
+
+    Bitvec08x16(uint16_t x00, uint16_t x01, uint16_t x02, uint16_t x03,
+                uint16_t x04, uint16_t x05, uint16_t x06, uint16_t x07) :
+            vec{x00, x01, x02, x03, x04, x05, x06, x07} {}
+
+    static inline Bitvec08x16 All(uint16_t value) {
+        return U16x8{} + value;
+    }
+
+    static inline Bitvec08x16
+    X_Y_and_Z_or(const Bitvec08x16 &x, const Bitvec08x16 &y, const Bitvec08x16 &z) {
+        return (x.vec & y.vec) | z.vec;
+    }
+
+    static inline Bitvec08x16
+    X_Y_or_Z_or(const Bitvec08x16 &x, const Bitvec08x16 &y, const Bitvec08x16 &z) {
+        return x.vec | y.vec | z.vec;
+    }
+
+    inline Bitvec08x16 &operator=(const Bitvec08x16 &other) = default;
+
+    inline bool operator==(const Bitvec08x16 &other) const {
+        return (*this ^ other).AllZero();
+    }
+
+    inline bool operator!=(const Bitvec08x16 &other) const {
+        return !(*this == other);
+    }
+
+    inline TwoBy64 As_2x64() const {
+        TwoBy64 out{};
+        memcpy(&out, &vec, sizeof(out));
+        return out;
+    }
+
+    inline Bitvec08x16 WhichEqual(const Bitvec08x16 &other) const {
+        return (U16x8) (vec == other.vec);
+    }
+
+    inline Bitvec08x16 WhichNonZero() const {
+        return (U16x8) ((I16x8) vec > 0);
+    }
+
+    inline bool AllZero() const {
+        U64x2 x = (U64x2) vec;
+        return (x[0] | x[1]) == 0;
+    }
+
+    inline bool AnyZero() const {
+        return !Bitvec08x16{(U16x8) (vec == 0)}.AllZero();
+    }
+
+    inline bool AnyLessThan(const Bitvec08x16 &other) const {
+        return !Bitvec08x16{(U16x8) ((I16x8) vec < (I16x8) other.vec)}.AllZero();
+    }
+
+    inline bool Intersects(const Bitvec08x16 &other) const {
+        return !(*this & other).AllZero();
+    }
+
+    inline bool SubsetOf(const Bitvec08x16 &other) const {
+        return and_not(other).AllZero();
+    }
+
+    inline Bitvec08x16 GetLowBit() const {
+        return vec & -vec;
+    }
+
+    // clears the lowest set bit of the vector taken as one 128-bit integer.
+    inline Bitvec08x16 ClearLowBit() const {
+        TwoBy64 x = As_2x64();
+        if (x.x0) {
+            x.x0 &= x.x0 - 1;
+        } else {
+            x.x1 &= x.x1 - 1;
+        }
+        Bitvec08x16 out;
+        memcpy(&out.vec, &x, sizeof(x));
+        return out;
+    }
+
+    // counts the number of bits set among the 9 lowest order bits of each packed 16-bit integer
+    // subject to the assumption that the 7 high bits are zero. results are undefined if any of
+    // the 7 high bits are nonzero.
+    inline Bitvec08x16 Popcounts9() const {
+        return LanePopcounts(vec);
+    }
+
+    inline int Popcount() const {
+        TwoBy64 x = As_2x64();
+        return __builtin_popcountll(x.x0) + __builtin_popcountll(x.x1);
+    }
+
+    inline uint32_t MinPosGreaterThanOrEqual(uint16_t min_val) {
+        U16x8 shifted = vec - min_val;
+        uint32_t min = 0xffff;
+        uint32_t pos = 0;
+        for (int i = 0; i < 8; i++) {
+            if (shifted[i] < min) {
+                min = shifted[i];
+                pos = i;
+            }
+        }
+        return (pos << 16u) | min;
+    }
+
+    inline Bitvec08x16 Shuffle(const Bitvec08x16 &control) const {
+        return (U16x8) ShuffleBytes((U8x16) vec, (U8x16) control.vec);
+    }
+
+    inline Bitvec08x16 RotateRows() const {
+        return TDOKU_PERMUTE16x8(vec, 1, 2, 3, 0, 5, 6, 7, 4);
+    }
+
+    inline Bitvec08x16 RotateRows2() const {
+        return TDOKU_PERMUTE16x8(vec, 2, 3, 0, 1, 6, 7, 4, 5);
+    }
+
+    inline Bitvec08x16 RotateCols() const {
+        return TDOKU_PERMUTE16x8(vec, 4, 5, 6, 7, 0, 1, 2, 3);
+    }
+
+    inline uint16_t Extract(int index) const {
+        return vec[index];
+    }
+
+    void Insert(int index, uint16_t value) {
+        vec[index] = value;
+    }
+
+    inline Bitvec08x16 operator|(const Bitvec08x16 &other) const {
+        return vec | other.vec;
+    }
+
+    inline void operator|=(const Bitvec08x16 &other) {
+        vec |= other.vec;
+    }
+
+    inline Bitvec08x16 operator^(const Bitvec08x16 &other) const {
+        return vec ^ other.vec;
+    }
+
+    inline void operator^=(const Bitvec08x16 &other) {
+        vec ^= other.vec;
+    }
+
+    inline Bitvec08x16 operator&(const Bitvec08x16 &other) const {
+        return vec & other.vec;
+    }
+
+    inline void operator&=(const Bitvec08x16 &other) {
+        vec &= other.vec;
+    }
+
+    inline Bitvec08x16 and_not(const Bitvec08x16 &other) const {
+        return vec & ~other.vec;
+    };
+};
+
+struct Bitvec16x16 {
+    U16x16 vec;
+
+    Bitvec16x16() noexcept : vec{} {}
+
+    // non-explicit conversions intended
+    Bitvec16x16(const U16x16 &u16x16) noexcept : vec{u16x16} {}
+
+    Bitvec16x16(const Bitvec16x16 &other) noexcept = default;
+
+    Bitvec16x16(const Bitvec08x16 &lo, const Bitvec08x16 &hi) noexcept {
+#ifdef TDOKU_HAVE_SHUFFLEVECTOR
+        vec = __builtin_shufflevector(lo.vec, hi.vec, 0, 1, 2, 3, 4, 5, 6, 7,
+                                      8, 9, 10, 11, 12, 13, 14, 15);
+#else
+        memcpy(&vec, &lo.vec, sizeof(lo.vec));
+        memcpy((char *) &vec + sizeof(lo.vec), &hi.vec, sizeof(hi.vec));
+#endif
+    }
+
+    Bitvec16x16(uint16_t x00, uint16_t x01, uint16_t x02, uint16_t x03,
+                uint16_t x04, uint16_t x05, uint16_t x06, uint16_t x07,
+                uint16_t x08, uint16_t x09, uint16_t x10, uint16_t x11,
+                uint16_t x12, uint16_t x13, uint16_t x14, uint16_t x15) noexcept :
+            vec{x00, x01, x02, x03, x04, x05, x06, x07,
+                x08, x09, x10, x11, x12, x13, x14, x15} {}
+
+    static inline Bitvec16x16 All(uint16_t value) {
+        return U16x16{} + value;
+    }
+
+    static inline Bitvec16x16
+    X_Y_and_Z_or(const Bitvec16x16 &x, const Bitvec16x16 &y, const Bitvec16x16 &z) {
+        return (x.vec & y.vec) | z.vec;
+    }
+
+    static inline Bitvec16x16
+    X_Y_andnot_Z_or(const Bitvec16x16 &x, const Bitvec16x16 &y, const Bitvec16x16 &z) {
+        return (x.vec & ~y.vec) | z.vec;
+    }
+
+    static inline Bitvec16x16
+    X_Y_or_Z_or(const Bitvec16x16 &x, const Bitvec16x16 &y, const Bitvec16x16 &z) {
+        return x.vec | y.vec | z.vec;
+    }
+
+    static inline Bitvec16x16
+    X_Y_xor_Z_or(const Bitvec16x16 &x, const Bitvec16x16 &y, const Bitvec16x16 &z) {
+        return (x.vec ^ y.vec) | z.vec;
+    }
+
+    inline Bitvec16x16 &operator=(const Bitvec16x16 &other) = default;
+
+    inline bool operator==(const Bitvec16x16 &other) const {
+        return (*this ^ other).AllZero();
+    }
+
+    inline bool operator!=(const Bitvec16x16 &other) const {
+        return !(*this == other);
+    }
+
+    inline Bitvec08x16 GetLo() const {
+#ifdef TDOKU_HAVE_SHUFFLEVECTOR
+        return (U16x8) __builtin_shufflevector(vec, vec, 0, 1, 2, 3, 4, 5, 6, 7);
+#else
+        Bitvec08x16 lo;
+        memcpy(&lo.vec, &vec, sizeof(lo.vec));
+        return lo;
+#endif
+    }
+
+    inline Bitvec08x16 GetHi() const {
+#ifdef TDOKU_HAVE_SHUFFLEVECTOR
+        return (U16x8) __builtin_shufflevector(vec, vec, 8, 9, 10, 11, 12, 13, 14, 15);
+#else
+        Bitvec08x16 hi;
+        memcpy(&hi.vec, (const char *) &vec + sizeof(hi.vec), sizeof(hi.vec));
+        return hi;
+#endif
+    }
+
+    inline FourBy64 As_4x64() const {
+        FourBy64 out{};
+        memcpy(&out, &vec, sizeof(out));
+        return out;
+    }
+
+    inline Bitvec16x16 WhichEqual(const Bitvec16x16 &other) const {
+        return (U16x16) (vec == other.vec);
+    }
+
+    inline Bitvec16x16 WhichNonZero() const {
+        return (U16x16) ((I16x16) vec > 0);
+    }
+
+    inline bool AllZero() const {
+        return (GetLo() | GetHi()).AllZero();
+    }
+
+    inline bool AnyZero() const {
+        return !Bitvec16x16{(U16x16) (vec == 0)}.AllZero();
+    }
+
+    inline bool AnyLessThan(const Bitvec16x16 &other) const {
+        return !Bitvec16x16{(U16x16) ((I16x16) vec < (I16x16) other.vec)}.AllZero();
+    }
+
+    inline bool Intersects(const Bitvec16x16 &other) const {
+        return !(*this & other).AllZero();
+    }
+
+    inline bool SubsetOf(const Bitvec16x16 &other) const {
+        return and_not(other).AllZero();
+    }
+
+    // counts the number of bits set among the 9 lowest order bits of each packed 16-bit integer
+    // subject to the assumption that the 7 high bits are zero. results are undefined if any of
+    // the 7 high bits are nonzero.
+    inline Bitvec16x16 Popcounts9() const {
+        return LanePopcounts(vec);
+    }
+
+    // like _mm256_shuffle_epi8, shuffles bytes within each 128-bit half.
+    inline Bitvec16x16 Shuffle(const Bitvec16x16 &control) const {
+        return (U16x16) ShuffleBytesInHalves((U8x32) vec, (U8x32) control.vec);
+    }
+
+    inline Bitvec16x16 RotateRows() const {
+        return TDOKU_PERMUTE16x16(vec, 1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12);
+    }
+
+    inline Bitvec16x16 RotateRows2() const {
+        return TDOKU_PERMUTE16x16(vec, 2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+    }
+
+    inline Bitvec16x16 RotateCols() const {
+        return TDOKU_PERMUTE16x16(vec, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3);
+    }
+
+    inline Bitvec16x16 RotateCols2() const {
+        return TDOKU_PERMUTE16x16(vec, 8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7);
+    }
+
+    inline uint16_t Extract(int index) const {
+        return vec[index];
+    }
+
+    inline void Insert(int index, uint16_t value) {
+        vec[index] = value;
+    }
+
+    inline Bitvec16x16 operator|(const Bitvec16x16 &other) const {
+        return vec | other.vec;
+    }
+
+    inline void operator|=(const Bitvec16x16 &other) {
+        vec |= other.vec;
+    }
+
+    inline Bitvec16x16 operator^(const Bitvec16x16 &other) const {
+        return vec ^ other.vec;
+    }
+
+    inline void operator^=(const Bitvec16x16 &other) {
+        vec ^= other.vec;
+    }
+
+    inline Bitvec16x16 operator&(const Bitvec16x16 &other) const {
+        return vec & other.vec;
+    }
+
+    inline void operator&=(const Bitvec16x16 &other) {
+        vec &= other.vec;
+    }
+
+    inline Bitvec16x16 and_not(const Bitvec16x16 &other) const {
+        return vec & ~other.vec;
+    };
+};
+
+inline uint32_t WhichDots16(const char *x) {
+    U8x16 src;
+    memcpy(&src, x, sizeof(src));
+    U8x16 dots = (U8x16) (src == '.');
+    uint32_t mask = 0;
+    for (int i = 0; i < 16; i++) {
+        mask |= (uint32_t) (dots[i] & 1u) << i;
+    }
+    return mask;
+}
+
+inline uint32_t WhichDots32(const char *x) {
+    return WhichDots16(x) | (WhichDots16(x + 16) << 16u);
+}
+
+inline uint64_t WhichDots64(const char *x) {
+    return (uint64_t) WhichDots32(x) | ((uint64_t) WhichDots32(x + 32) << 32u);
+}
+
+#undef TDOKU_PERMUTE16x8
+#undef TDOKU_PERMUTE16x16
+
+#pragma GCC diagnostic pop
+
+#endif //TDOKU_SIMD_VECTORS_GENERIC_H
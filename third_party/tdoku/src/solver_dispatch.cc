@@ -0,0 +1,168 @@
+#include "../include/tdoku.h"
+#include "grid_lib.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Runtime instruction set dispatch for the SIMD solver. With cmake -DDISPATCH=ON the solver is
+// compiled once for baseline x86-64, SSE4.2, AVX2 and AVX512-BITALG (see CMakeLists.txt), and
+// the entry points below forward to the best of those the host supports. The choice is made once,
+// on first use, and can be overridden by setting TDOKU_ISA to one of the names in kVariants.
+//
+// Without DISPATCH there's just the one build, and this only reports what it was compiled for.
+
+namespace {
+
+using SolveFn = size_t (*)(const char *, size_t, uint32_t, char *, size_t *);
+using EnumerateFn = size_t (*)(const char *, size_t, void (*)(const char *, void *), void *);
+using SolveReverseFn = size_t (*)(const char *, size_t, char *, size_t *);
+
+struct IsaVariant {
+    const char *name;
+    SolveFn solve;
+    EnumerateFn enumerate;
+    SolveReverseFn solve_reverse;
+    bool (*supported)();
+};
+
+bool Always() {
+    return true;
+}
+
+} // namespace
+
+#ifdef TDOKU_DISPATCH
+
+#define TDOKU_DECLARE_ISA_VARIANT(isa)                                                   \
+    size_t TdokuSolverDpllTriadSimd_##isa(const char *, size_t, uint32_t, char *, size_t *);  \
+    size_t TdokuEnumerate_##isa(const char *, size_t, void (*)(const char *, void *), void *);  \
+    size_t TdokuSolveReverse_##isa(const char *, size_t, char *, size_t *);
+
+extern "C" {
+TDOKU_DECLARE_ISA_VARIANT(baseline)
+TDOKU_DECLARE_ISA_VARIANT(sse42)
+TDOKU_DECLARE_ISA_VARIANT(avx2)
+TDOKU_DECLARE_ISA_VARIANT(avx512)
+}
+
+namespace {
+
+// these mirror the compile flags given to each build in CMakeLists.txt. libgcc's checks for
+// avx2 and the avx512 features also confirm the OS saves the wider registers.
+bool HasSse42() {
+    // cheap once done, and we may be reached from another translation unit's static initializer.
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt");
+}
+
+bool HasAvx2() {
+    return HasSse42() && __builtin_cpu_supports("avx2");
+}
+
+bool HasAvx512() {
+    return HasAvx2() && __builtin_cpu_supports("avx512vl") && __builtin_cpu_supports("avx512bw")
+           && __builtin_cpu_supports("avx512bitalg");
+}
+
+// in order of preference, lowest first.
+const IsaVariant kVariants[] = {
+        {"baseline",     TdokuSolverDpllTriadSimd_baseline, TdokuEnumerate_baseline,
+                         TdokuSolveReverse_baseline, Always},
+        {"sse4.2",       TdokuSolverDpllTriadSimd_sse42,    TdokuEnumerate_sse42,
+                         TdokuSolveReverse_sse42,    HasSse42},
+        {"avx2",         TdokuSolverDpllTriadSimd_avx2,     TdokuEnumerate_avx2,
+                         TdokuSolveReverse_avx2,     HasAvx2},
+        {"avx512bitalg", TdokuSolverDpllTriadSimd_avx512,   TdokuEnumerate_avx512,
+                         TdokuSolveReverse_avx512,   HasAvx512},
+};
+
+const IsaVariant *SelectVariant() {
+    const IsaVariant *best = &kVariants[0];
+    for (const IsaVariant &variant : kVariants) {
+        if (variant.supported()) best = &variant;
+    }
+
+    const char *requested = getenv("TDOKU_ISA");
+    if (requested == nullptr || *requested == '\0') return best;
+    for (const IsaVariant &variant : kVariants) {
+        if (strcmp(variant.name, requested) == 0 && variant.supported()) return &variant;
+    }
+    fprintf(stderr, "tdoku: TDOKU_ISA=%s is not built or not supported on this host, using %s\n",
+            requested, best->name);
+    return best;
+}
+
+const IsaVariant &Selected() {
+    static const IsaVariant *selected = SelectVariant();
+    return *selected;
+}
+
+} // namespace
+
+extern "C"
+size_t TdokuSolverDpllTriadSimd(const char *puzzle, size_t limit,
+                                uint32_t configuration,
+                                char *solution, size_t *num_guesses) {
+    return Selected().solve(puzzle, limit, configuration, solution, num_guesses);
+}
+
+extern "C"
+size_t TdokuEnumerate(const char *puzzle, size_t limit,
+                      void (*callback)(const char *, void *), void *callback_arg) {
+    return Selected().enumerate(puzzle, limit, callback, callback_arg);
+}
+
+extern "C"
+size_t TdokuSolveReverse(const char *puzzle, size_t limit, char *solution, size_t *num_guesses) {
+    return Selected().solve_reverse(puzzle, limit, solution, num_guesses);
+}
+
+#else // !TDOKU_DISPATCH
+
+namespace {
+
+#if (defined TDOKU_GENERIC_SIMD || !(defined __x86_64__ || defined __i386__))
+constexpr const char *kBuildIsa = "generic";
+#elif (defined __AVX512BITALG__ && defined __AVX512VL__)
+constexpr const char *kBuildIsa = "avx512bitalg";
+#elif defined __AVX2__
+constexpr const char *kBuildIsa = "avx2";
+#elif defined __SSE4_2__
+constexpr const char *kBuildIsa = "sse4.2";
+#else
+constexpr const char *kBuildIsa = "baseline";
+#endif
+
+const IsaVariant kVariants[] = {
+        {kBuildIsa, TdokuSolverDpllTriadSimd, TdokuEnumerate, TdokuSolveReverse, Always},
+};
+
+const IsaVariant &Selected() {
+    return kVariants[0];
+}
+
+} // namespace
+
+#endif // TDOKU_DISPATCH
+
+extern "C"
+size_t TdokuNumIsaVariants() {
+    return sizeof(kVariants) / sizeof(kVariants[0]);
+}
+
+extern "C"
+const char *TdokuIsaVariantName(size_t which) {
+    return which < TdokuNumIsaVariants() ? kVariants[which].name : nullptr;
+}
+
+extern "C"
+TdokuSolverFn TdokuIsaVariantSolver(size_t which) {
+    if (which >= TdokuNumIsaVariants() || !kVariants[which].supported()) return nullptr;
+    return kVariants[which].solve;
+}
+
+extern "C"
+const char *TdokuSelectedIsa() {
+    return Selected().name;
+}
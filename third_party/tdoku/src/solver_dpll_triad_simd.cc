@@ -1,7 +1,41 @@
+// With cmake -DDISPATCH=ON this file is compiled once per instruction set and
+// solver_dispatch.cc picks one at runtime. Each ISA build defines TDOKU_ISA_VARIANT, suffixes
+// its entry points with it, and leaves out the generator, which stays in the baseline build.
+#ifdef TDOKU_ISA_VARIANT
+#define TDOKU_ISA_PASTE_(name, isa) name##_##isa
+#define TDOKU_ISA_PASTE(name, isa) TDOKU_ISA_PASTE_(name, isa)
+#define TDOKU_ISA_ENTRY(name) TDOKU_ISA_PASTE(name, TDOKU_ISA_VARIANT)
+#elif defined TDOKU_DISPATCH
+#define TDOKU_ISA_ENTRY(name) name##_baseline
+#else
+#define TDOKU_ISA_ENTRY(name) name
+#endif
+
+#ifdef TDOKU_ISA_VARIANT
+// the vector types' inline members would otherwise be emitted under the same symbols by every
+// ISA build, leaving the linker free to keep, say, the AVX512 copy for all of them. so give this
+// build its own copy of the headers (system headers first, so they stay at global scope).
+#include <cstdint>
+#include <cstring>
+#include <immintrin.h>
+#include <memory>
+#include <tuple>
+#include <utility>
+namespace TDOKU_ISA_PASTE(tdoku, TDOKU_ISA_VARIANT) {
+#include "bitutil.h"
+#include "simd_vectors.h"
+}
+using namespace TDOKU_ISA_PASTE(tdoku, TDOKU_ISA_VARIANT);
+#else
 #include "bitutil.h"
 #include "simd_vectors.h"
 #include "util.h"
 
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#endif
+
 #include <array>
 #include <cstring>
 
@@ -262,7 +296,9 @@ struct Tables {
 
 const Tables tables{};
 
-template<int solution_mode>
+// with reverse_order set we explore the negation of each guess before the guess itself. the
+// search tree is the same, so solutions are found in exactly the opposite order.
+template<int solution_mode, bool reverse_order = false>
 struct SolverDpllTriadSimd {
     State solution_{};
     size_t limit_ = 1;
@@ -545,14 +581,16 @@ struct SolverDpllTriadSimd {
         num_guesses_++;
         State state_copy = state;
         Cells08 assignment_elims = value_configurations.ClearLowBit();
-        state_copy.bands[vertical][band_idx].eliminations |= assignment_elims;
+        Cells08 negation_elims = value_configurations ^ assignment_elims;
+        state_copy.bands[vertical][band_idx].eliminations |=
+                reverse_order ? negation_elims : assignment_elims;
         if (BandEliminate<vertical>(state_copy, band_idx)) {
             CountSolutionsConsistentWithPartialAssignment(state_copy);
             if (num_solutions_ == limit_) return;
         }
         // now negate the first configuration
-        Cells08 negation_elims = value_configurations ^ assignment_elims;
-        state.bands[vertical][band_idx].eliminations |= negation_elims;
+        state.bands[vertical][band_idx].eliminations |=
+                reverse_order ? assignment_elims : negation_elims;
         if (BandEliminate<vertical>(state, band_idx)) {
             CountSolutionsConsistentWithPartialAssignment(state);
         }
@@ -695,6 +733,7 @@ struct SolverDpllTriadSimd {
 };
 
 
+#ifndef TDOKU_ISA_VARIANT
 struct GeneratorDpllTriadSimd {
     SolverDpllTriadSimd<0> solver_{};
     Util util_;
@@ -759,15 +798,112 @@ struct GeneratorDpllTriadSimd {
     // minimizes a vanilla or pencilmark puzzle by testing removal of all clues in random order,
     // restoring any clue that's required to keep the solution unique. if the 'monotonic' flag
     // is passed, returns true only if we had a minimal puzzle after the first restored clue.
+    //
+    // while the puzzle's solution is unique, removing a clue keeps it unique exactly when no
+    // solution violates that clue. so each trial is a search for one such solution rather than
+    // a count to two, and it starts from a propagated state shared with neighbouring trials
+    // (see MinimizeRange) instead of from the puzzle text. clues are tested once each, and a
+    // clue found necessary stays in every later trial's starting state.
     bool Minimize(bool pencilmark, bool monotonic, char *puzzle) {
-        bool restored_clue = false;
         vector<int> permutation = util_.Permutation(729);
+        State state;
+        bool consistent = pencilmark ? SolverDpllTriadSimd<0>::InitPencilmarkByBox(puzzle, state)
+                                     : SolverDpllTriadSimd<0>::InitVanillaByBand(puzzle, state);
+        if (!consistent || solver_.SafeCountSolutionsConsistentWithPartialAssignment(state, 2) != 1) {
+            return MinimizeByResolving(pencilmark, monotonic, permutation, puzzle);
+        }
+        vector<int> clues;
         for (int cell_or_literal : permutation) {
-            if (pencilmark) {
-                if (puzzle[cell_or_literal] != '.') continue;
-            } else {
-                if (cell_or_literal >= 81 || puzzle[cell_or_literal] == '.') continue;
+            if (IsClue(pencilmark, puzzle, cell_or_literal)) clues.push_back(cell_or_literal);
+        }
+        bool restored_clue = false;
+        return MinimizeRange(pencilmark, monotonic, clues.data(), clues.data() + clues.size(),
+                             State{}, restored_clue, puzzle);
+    }
+
+    static bool IsClue(bool pencilmark, const char *puzzle, int cell_or_literal) {
+        if (pencilmark) return puzzle[cell_or_literal] == '.';
+        return cell_or_literal < 81 && puzzle[cell_or_literal] != '.';
+    }
+
+    // restricts the state with those of the given clues still in the puzzle, batching the
+    // restrictions by box. clues all hold in the puzzle's solution, so this can't fail.
+    static void AddClues(bool pencilmark, const char *puzzle, const int *begin, const int *end,
+                         State &state) {
+        Cells16 restrictions[9];
+        bool restricted[9]{};
+        for (const int *clue = begin; clue != end; clue++) {
+            if (!IsClue(pencilmark, puzzle, *clue)) continue;
+            int cell = pencilmark ? *clue / 9 : *clue;
+            uint16_t digit = 1u << (pencilmark ? *clue % 9 : puzzle[cell] - '1');
+            int row = cell / 9, col = cell % 9;
+            int box_idx = (row / 3) * 3 + (col / 3);
+            int elm_idx = (row % 3) * 4 + (col % 3);
+            if (!restricted[box_idx]) {
+                restrictions[box_idx] = Cells16::All(kAll);
+                restricted[box_idx] = true;
+            }
+            uint16_t allowed = restrictions[box_idx].Extract(elm_idx);
+            restrictions[box_idx].Insert(elm_idx, pencilmark ? allowed & ~digit : digit);
+        }
+        for (int box_idx = 0; box_idx < 9; box_idx++) {
+            if (restricted[box_idx]) {
+                SolverDpllTriadSimd<0>::BoxRestrict<0>(state, box_idx, restrictions[box_idx]);
             }
+        }
+    }
+
+    // restricts the state to assignments violating the clue, returning false if there are none.
+    static bool ViolateClue(bool pencilmark, const char *puzzle, int cell_or_literal,
+                            State &state) {
+        int cell = pencilmark ? cell_or_literal / 9 : cell_or_literal;
+        uint16_t digit = 1u << (pencilmark ? cell_or_literal % 9 : puzzle[cell] - '1');
+        int row = cell / 9, col = cell % 9;
+        int box_idx = (row / 3) * 3 + (col / 3);
+        int elm_idx = (row % 3) * 4 + (col % 3);
+        Cells16 restrict = state.boxen[box_idx].cells;
+        uint16_t candidates = restrict.Extract(elm_idx);
+        restrict.Insert(elm_idx, pencilmark ? candidates & digit : candidates & ~digit);
+        return SolverDpllTriadSimd<0>::BoxRestrict<0>(state, box_idx, restrict);
+    }
+
+    // tests the clues in [begin, end) for removal in order, given a state reflecting all of the
+    // puzzle's other clues. the first half is tested from that state plus the (as yet untested)
+    // second half, and the second half from that state plus whatever survived of the first, so
+    // each clue is added to O(log n) states rather than every trial re-initializing the puzzle.
+    bool MinimizeRange(bool pencilmark, bool monotonic, const int *begin, const int *end,
+                       const State &state, bool &restored_clue, char *puzzle) {
+        if (begin == end) return true;
+        if (end - begin == 1) {
+            State test_state = state;
+            if (ViolateClue(pencilmark, puzzle, *begin, test_state) &&
+                solver_.SafeCountSolutionsConsistentWithPartialAssignment(test_state, 1) > 0) {
+                restored_clue = true;
+                return true;
+            }
+            puzzle[*begin] = pencilmark ? (char) ('1' + (*begin % 9)) : '.';
+            return !(monotonic && restored_clue);
+        }
+        const int *middle = begin + (end - begin) / 2;
+        State first_state = state;
+        AddClues(pencilmark, puzzle, middle, end, first_state);
+        if (!MinimizeRange(pencilmark, monotonic, begin, middle, first_state, restored_clue,
+                           puzzle)) {
+            return false;
+        }
+        State second_state = state;
+        AddClues(pencilmark, puzzle, begin, middle, second_state);
+        return MinimizeRange(pencilmark, monotonic, middle, end, second_state, restored_clue,
+                             puzzle);
+    }
+
+    // the straightforward version of Minimize, re-solving the puzzle from text for each clue
+    // removed. used for puzzles that don't start out with a unique solution.
+    bool MinimizeByResolving(bool pencilmark, bool monotonic, const vector<int> &permutation,
+                             char *puzzle) {
+        bool restored_clue = false;
+        for (int cell_or_literal : permutation) {
+            if (!IsClue(pencilmark, puzzle, cell_or_literal)) continue;
             char constraint = puzzle[cell_or_literal];
             State state;
             if (pencilmark) {
@@ -787,20 +923,24 @@ struct GeneratorDpllTriadSimd {
         return true;
     }
 };
+#endif
 
+// one of each per thread, so that every entry point below is safe to call concurrently.
+thread_local SolverDpllTriadSimd<0> solver_none{};
+thread_local SolverDpllTriadSimd<1> solver_last{};
+thread_local SolverDpllTriadSimd<1, true> solver_last_reverse{};
+thread_local SolverDpllTriadSimd<2> solver_enum{};
 
-SolverDpllTriadSimd<0> solver_none{};
-SolverDpllTriadSimd<1> solver_last{};
-SolverDpllTriadSimd<2> solver_enum{};
-
-GeneratorDpllTriadSimd generator{};
+#ifndef TDOKU_ISA_VARIANT
+thread_local GeneratorDpllTriadSimd generator{};
+#endif
 
 } // namespace
 
 extern "C"
-size_t TdokuSolverDpllTriadSimd(const char *puzzle, size_t limit,
-                                uint32_t configuration,
-                                char *solution, size_t *num_guesses) {
+size_t TDOKU_ISA_ENTRY(TdokuSolverDpllTriadSimd)(const char *puzzle, size_t limit,
+                                                 uint32_t configuration,
+                                                 char *solution, size_t *num_guesses) {
     bool return_last = limit == 1 || configuration > 0;
     if (return_last) {
         return solver_last.SolveSudoku(puzzle, limit, solution, num_guesses);
@@ -809,14 +949,25 @@ size_t TdokuSolverDpllTriadSimd(const char *puzzle, size_t limit,
     }
 }
 
+// finds solutions in the reverse of TdokuSolverDpllTriadSimd's order and returns the last of the
+// first 'limit', i.e. the limit-th solution from the end of the usual order. for GetGrid's seeks
+// (see grid_lib.h); not a SolverFn, so benchmark configurations can't reach it.
+extern "C"
+size_t TDOKU_ISA_ENTRY(TdokuSolveReverse)(const char *puzzle, size_t limit, char *solution,
+                                          size_t *num_guesses) {
+    return solver_last_reverse.SolveSudoku(puzzle, limit, solution, num_guesses);
+}
+
 extern "C"
-size_t TdokuEnumerate(const char *puzzle, size_t limit,
-                      void (*callback)(const char *, void *), void *callback_arg) {
+size_t TDOKU_ISA_ENTRY(TdokuEnumerate)(const char *puzzle, size_t limit,
+                                       void (*callback)(const char *, void *),
+                                       void *callback_arg) {
     solver_enum.callback_ = callback;
     solver_enum.callback_arg_ = callback_arg;
     return solver_enum.SolveSudoku(puzzle, limit, nullptr, nullptr);
 }
 
+#ifndef TDOKU_ISA_VARIANT
 extern "C"
 bool TdokuConstrain(bool pencilmark, char *puzzle) {
     return generator.Constrain(pencilmark, puzzle);
@@ -826,3 +977,36 @@ extern "C"
 bool TdokuMinimize(bool pencilmark, bool monotonic, char *puzzle) {
     return generator.Minimize(pencilmark, monotonic, puzzle);
 }
+
+extern "C"
+void TdokuRandomSeed(uint64_t seed) {
+    generator.util_.RandomSeed(seed);
+}
+
+extern "C"
+size_t TdokuMinimizeBatch(bool pencilmark, bool monotonic, size_t num_puzzles, char *puzzles,
+                          bool *results, int num_threads, uint64_t seed) {
+    size_t stride = pencilmark ? 729 : 81;
+    atomic<size_t> next_puzzle{0};
+    atomic<size_t> num_true{0};
+    // each thread claims puzzles one at a time and minimizes them with its own generator, reseeded
+    // from the puzzle's index so that which thread gets a puzzle doesn't change its result.
+    auto work = [&]() {
+        size_t count = 0;
+        for (size_t i = next_puzzle++; i < num_puzzles; i = next_puzzle++) {
+            generator.util_.RandomSeed(SplitMix64(seed + i));
+            bool result = generator.Minimize(pencilmark, monotonic, puzzles + i * stride);
+            if (results != nullptr) results[i] = result;
+            count += result;
+        }
+        num_true += count;
+    };
+    if (num_threads <= 0) num_threads = (int) thread::hardware_concurrency();
+    num_threads = (int) min<size_t>((size_t) max(num_threads, 1), max<size_t>(num_puzzles, 1));
+    vector<thread> threads;
+    for (int i = 1; i < num_threads; i++) threads.emplace_back(work);
+    work();
+    for (thread &t : threads) t.join();
+    return num_true;
+}
+#endif
@@ -1,8 +1,9 @@
 #include "util.h"
 #include <algorithm>
 #include <array>
-#include <vector>
+#include <cstdint>
 #include <cstring>
+#include <vector>
 
 using namespace std;
 
@@ -42,7 +43,10 @@ void Util::BlockShuffle(array<int, 9> *vec) {
 }
 
 // permute rows, columns, bands, and digits to produce a randomly transformed but
-// equivalent puzzle.
+// equivalent puzzle. the permutations are turned into a table of source positions for the 81
+// cells and a table relabelling each input character, and the result is gathered through them
+// into a buffer on the stack. (for pencilmark input the source is a digit's position within a
+// cell, and the relabelling is of whole 9-character cells.)
 void Util::PermuteSudoku(char *puzzle, bool pencilmark) {
     array<int, 9> digit_permutation{0, 1, 2, 3, 4, 5, 6, 7, 8};
     shuffle(digit_permutation.begin(), digit_permutation.end(), rng_);
@@ -52,30 +56,74 @@ void Util::PermuteSudoku(char *puzzle, bool pencilmark) {
     BlockShuffle(&col_permutation);
     BlockShuffle(&row_permutation);
 
-    size_t row_size = pencilmark ? 81 : 9;
-    size_t puzzle_size = row_size * 9;
-
-    vector<char> out_puzzle;
-    out_puzzle.resize(puzzle_size);
-
+    // source_cells[i] is the input cell that lands on output cell i.
+    array<uint8_t, 81> source_cells{};
     for (int row = 0; row < 9; row++) {
         for (int col = 0; col < 9; col++) {
-            if (pencilmark) {
-                for (int digit = 0; digit < 9; digit++) {
-                    bool eliminated = puzzle[row * 81 + col * 9 + digit] == '.';
-                    out_puzzle[row_permutation[row] * 81 +
-                               col_permutation[col] * 9 +
-                               digit_permutation[digit]] =
-                            eliminated ? '.' : (char) ('1' + digit_permutation[digit]);
-                }
-            } else {
-                char digit = puzzle[row * 9 + col];
-                if (digit != '.') {
-                    digit = (char) ('1' + digit_permutation[digit - '1']);
+            source_cells[row_permutation[row] * 9 + col_permutation[col]] = (uint8_t) (row * 9 + col);
+        }
+    }
+    char out_puzzle[729];
+    if (pencilmark) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        // each cell's candidates go through a 9-bit mask: packed from its characters 8 at a
+        // time, moved to their new digits 4 bits at a time through digit_bits tables built for
+        // this permutation, then expanded back to characters through expand_chars. packing and
+        // expanding both take a cell's first character to be the low byte of a word.
+        static const array<uint64_t, 256> expand_chars = []() {
+            array<uint64_t, 256> table{};
+            for (int mask = 0; mask < 256; mask++) {
+                char chars[8];
+                for (int digit = 0; digit < 8; digit++) {
+                    chars[digit] = (mask >> digit) & 1 ? (char) ('1' + digit) : '.';
                 }
-                out_puzzle[row_permutation[row] * 9 + col_permutation[col]] = digit;
+                memcpy(&table[mask], chars, 8);
+            }
+            return table;
+        }();
+        array<uint16_t, 16> digit_bits_0_3{}, digit_bits_4_7{};
+        for (int mask = 1; mask < 16; mask++) {
+            int digit = __builtin_ctz(mask);
+            digit_bits_0_3[mask] = digit_bits_0_3[mask & (mask - 1)] |
+                                   (uint16_t) (1u << digit_permutation[digit]);
+            digit_bits_4_7[mask] = digit_bits_4_7[mask & (mask - 1)] |
+                                   (uint16_t) (1u << digit_permutation[digit + 4]);
+        }
+        uint32_t digit_bit_8 = 1u << (uint32_t) digit_permutation[8];
+        for (int i = 0; i < 81; i++) {
+            const char *in_cell = &puzzle[source_cells[i] * 9];
+            uint64_t chars;
+            memcpy(&chars, in_cell, 8);
+            // a byte's high bit is set iff it isn't '.' (input characters are < 0x80).
+            uint64_t dots = chars ^ 0x2e2e2e2e2e2e2e2eull;
+            uint64_t present = ((dots + 0x7f7f7f7f7f7f7f7full) & 0x8080808080808080ull);
+            auto mask = (uint32_t) (((present >> 7) * 0x0102040810204080ull) >> 56);
+            // candidates come and go at random, so digit 8 is handled with arithmetic rather
+            // than branches.
+            uint32_t out_mask = digit_bits_0_3[mask & 0xfu] | digit_bits_4_7[mask >> 4u] |
+                                (digit_bit_8 & -(uint32_t) (in_cell[8] != '.'));
+            memcpy(&out_puzzle[i * 9], &expand_chars[out_mask & 0xffu], 8);
+            out_puzzle[i * 9 + 8] = (char) ('.' + ('9' - '.') * (out_mask >> 8u));
+        }
+#else
+        for (int i = 0; i < 81; i++) {
+            const char *in_cell = &puzzle[source_cells[i] * 9];
+            for (int digit = 0; digit < 9; digit++) {
+                out_puzzle[i * 9 + digit_permutation[digit]] =
+                        in_cell[digit] == '.' ? '.' : (char) ('1' + digit_permutation[digit]);
             }
         }
+#endif
+        memcpy(puzzle, out_puzzle, 729);
+    } else {
+        array<char, 256> relabel{};
+        for (int c = 0; c < 256; c++) relabel[c] = (char) c;
+        for (int digit = 0; digit < 9; digit++) {
+            relabel['1' + digit] = (char) ('1' + digit_permutation[digit]);
+        }
+        for (int i = 0; i < 81; i++) {
+            out_puzzle[i] = relabel[(uint8_t) puzzle[source_cells[i]]];
+        }
+        memcpy(puzzle, out_puzzle, 81);
     }
-    strncpy(puzzle, &out_puzzle[0], puzzle_size);
 }
@@ -1,7 +1,17 @@
 #include <array>
+#include <cstdint>
 #include <random>
 #include <vector>
 
+// a fixed 64-bit mix (splitmix64's output function applied to x plus its increment), for deriving
+// a well-spread seed per item from a base seed and an item index.
+inline uint64_t SplitMix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30u)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27u)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31u);
+}
+
 class Util {
 private:
     std::random_device rd{};
@@ -1,12 +1,19 @@
 #include "../src/all_solvers.h"
 #include "../src/bitutil.h"
+#include "../src/grid_lib.h"
+#include "../src/util.h"
+#include "drake.h"
+#include "tdoku.h"
 
+#include <algorithm>
+#include <array>
 #include <chrono>
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include <random>
 #include <sstream>
 #include <vector>
 
@@ -58,6 +65,516 @@ void Run(const string &testdata_filename, const Solver &solver, bool verbose) {
     if (!fail) cout << "PASS: " << solver.Id() << endl;
 }
 
+// the drake library's batch call on all the test puzzles at once, on several threads, with
+// interleave puzzles in flight per thread.
+void RunDrakeBatch(const string &testdata_filename, int interleave, uint32_t configuration,
+                   bool verbose) {
+    string id = "drake/lib batch";
+    if (interleave > 1) id += " interleave " + to_string(interleave);
+    if (configuration & 8u) id += " singles";
+    ifstream file(testdata_filename);
+    string line, puzzles;
+    vector<string> expects, solutions;
+    while (getline(file, line)) {
+        stringstream ss(line);
+        string puzzle, expect, solution;
+        getline(ss, puzzle, ':');
+        getline(ss, expect, ':');
+        getline(ss, solution, ':');
+        puzzles += puzzle;
+        expects.push_back(expect);
+        solutions.push_back(solution);
+    }
+    vector<DrakeResult> results(expects.size());
+    size_t num_solved = DrakeSolveBatchInterleaved(false, expects.size(), puzzles.c_str(),
+                                                   100000, configuration, results.data(), 4,
+                                                   interleave);
+    size_t expect_solved = 0;
+    bool fail = false;
+    for (size_t i = 0; i < expects.size(); i++) {
+        size_t expect = stoul(expects[i]);
+        expect_solved += expect > 0;
+        bool this_fail = results[i].num_solutions != expect ||
+                         (expect == 1 && strncmp(solutions[i].c_str(), results[i].solution, 81));
+        if (this_fail || verbose) {
+            cout << (this_fail ? "FAIL: " : "") << id << "\n"
+                 << "      puzzle:   " << puzzles.substr(i * 81, 81) << "\n"
+                 << "      expected: " << expect << " " << solutions[i] << "\n"
+                 << "      observed: " << results[i].num_solutions << " "
+                 << string(results[i].solution, 81) << endl;
+        }
+        fail |= this_fail;
+    }
+    if (num_solved != expect_solved) {
+        cout << "FAIL: " << id << " solved " << num_solved << ", expected " << expect_solved
+             << endl;
+        fail = true;
+    }
+    if (!fail) cout << "PASS: " << id << endl;
+}
+
+// the drake library's parallel counter with an explicit thread count, so that it splits the
+// search into cubes even on a single core, and with a limit below some of the counts. a full
+// count's guesses on 2, 4 and 8 threads stay close to the serial search's: splitting moves
+// some guesses around, but refuted cubes count none.
+void RunDrakeCount(const string &testdata_filename, bool verbose) {
+    ifstream file(testdata_filename);
+    string line;
+    bool fail = false;
+    while (getline(file, line)) {
+        stringstream ss(line);
+        string puzzle, expect_str;
+        getline(ss, puzzle, ':');
+        getline(ss, expect_str, ':');
+        size_t expect = stoul(expect_str);
+        char solution[81];
+        size_t serial_guesses;
+        DrakeSolveSudoku(puzzle.c_str(), 100000, 3, solution, &serial_guesses);
+        for (int num_threads : {2, 4, 8}) {
+            size_t guesses;
+            DrakeCountSolutions(puzzle.c_str(), 100000, 3, &guesses, num_threads);
+            size_t difference = guesses > serial_guesses ? guesses - serial_guesses
+                                                         : serial_guesses - guesses;
+            bool this_fail = difference > 16 + serial_guesses / 8;
+            if (this_fail || verbose) {
+                cout << (this_fail ? "FAIL: " : "") << "drake/lib_count guesses\n"
+                     << "      puzzle:   " << puzzle << "\n"
+                     << "      threads:  " << num_threads << "\n"
+                     << "      expected: about " << serial_guesses << "\n"
+                     << "      observed: " << guesses << endl;
+            }
+            fail |= this_fail;
+        }
+        for (size_t limit : {(size_t) 100000, (size_t) 100}) {
+            size_t guesses;
+            size_t count = DrakeCountSolutions(puzzle.c_str(), limit, 3, &guesses, 4);
+            bool this_fail = count != min(expect, limit);
+            if (this_fail || verbose) {
+                cout << (this_fail ? "FAIL: " : "") << "drake/lib_count 4 threads\n"
+                     << "      puzzle:   " << puzzle << "\n"
+                     << "      limit:    " << limit << "\n"
+                     << "      expected: " << min(expect, limit) << "\n"
+                     << "      observed: " << count << endl;
+            }
+            fail |= this_fail;
+        }
+    }
+    if (!fail) cout << "PASS: drake/lib_count 4 threads" << endl;
+}
+
+// the drake library's budgeted solve. a budget the search fits in changes nothing, and a guess
+// budget one short of what it needs stops it, keeping the puzzle's clues in the partial grid.
+// for a puzzle that needs one guess that's a budget of zero, which stops before the guess.
+void RunDrakeBudget(const string &testdata_filename, bool verbose) {
+    ifstream file(testdata_filename);
+    string line;
+    bool fail = false;
+    while (getline(file, line)) {
+        stringstream ss(line);
+        string puzzle, expect_str;
+        getline(ss, puzzle, ':');
+        getline(ss, expect_str, ':');
+        size_t expect = stoul(expect_str);
+        char solution[81];
+        size_t guesses;
+        DrakeSolveSudoku(puzzle.c_str(), 100000, 3, solution, &guesses);
+
+        DrakeResult result;
+        char partial[81];
+        DrakeBudget ample{guesses + 1, 10000000};
+        DrakeStatus status = DrakeSolveSudokuWithBudget(puzzle.c_str(), 100000, 3, &ample,
+                                                        &result, partial);
+        bool this_fail = status != DRAKE_COMPLETE || result.num_solutions != expect ||
+                         result.num_guesses != guesses;
+        if (guesses > 0) {
+            DrakeBudget short_budget{guesses - 1, DRAKE_NO_TIME_LIMIT};
+            status = DrakeSolveSudokuWithBudget(puzzle.c_str(), 100000, 3, &short_budget,
+                                                &result, partial);
+            this_fail |= status != DRAKE_BUDGET_EXHAUSTED || result.num_guesses != guesses - 1 ||
+                         result.num_solutions > expect;
+            for (int i = 0; i < 81; i++) {
+                this_fail |= puzzle[i] != '.' && partial[i] != puzzle[i];
+            }
+        } else {
+            // a zero budget is a bound, not no bound, and one a search without guesses fits in.
+            DrakeBudget zero_budget{0, 0};
+            status = DrakeSolveSudokuWithBudget(puzzle.c_str(), 100000, 3, &zero_budget,
+                                                &result, partial);
+            this_fail |= status != DRAKE_COMPLETE || result.num_solutions != expect;
+        }
+        if (this_fail || verbose) {
+            cout << (this_fail ? "FAIL: " : "") << "drake/lib budget\n"
+                 << "      puzzle:   " << puzzle << "\n"
+                 << "      expected: " << expect << " solutions, " << guesses << " guesses\n"
+                 << "      observed: " << result.num_solutions << " solutions, "
+                 << result.num_guesses << " guesses, status " << status << endl;
+        }
+        fail |= this_fail;
+    }
+
+    // an exhausted budget doesn't carry over to a puzzle the singles pre-pass settles.
+    const string kEmptyGrid(81, '.');
+    const char *kSinglesPuzzle =
+            "..3.2.6..9..3.5..1..18.64....81.29..7.......8..67.82....26.95..8..2.3..9..5.1.3..";
+    DrakeResult result;
+    DrakeBudget one_guess{1, DRAKE_NO_TIME_LIMIT};
+    DrakeStatus exhausted = DrakeSolveSudokuWithBudget(kEmptyGrid.c_str(), 1, 11, &one_guess,
+                                                       &result, nullptr);
+    DrakeStatus settled = DrakeSolveSudokuWithBudget(kSinglesPuzzle, 2, 11, &one_guess,
+                                                     &result, nullptr);
+    bool this_fail = exhausted != DRAKE_BUDGET_EXHAUSTED || settled != DRAKE_COMPLETE ||
+                     result.num_solutions != 1 || result.num_guesses != 0;
+    if (this_fail || verbose) {
+        cout << (this_fail ? "FAIL: " : "") << "drake/lib budget after an exhausted one\n"
+             << "      observed: status " << exhausted << " then " << settled << ", "
+             << result.num_solutions << " solutions, " << result.num_guesses << " guesses"
+             << endl;
+    }
+    fail |= this_fail;
+    if (!fail) cout << "PASS: drake/lib budget" << endl;
+}
+
+// GetGrid seeks from the far end of a pattern's solutions with TdokuSolveReverse, so its k-th
+// solution has to be the k-th from the end of TdokuEnumerate's order. checked on a few band
+// patterns, for the first and last few k of each.
+void RunTdokuReverse(bool verbose) {
+    bool fail = false;
+    for (int pattern_id : {0, 1, 1000, 100000}) {
+        char pattern[82];
+        GetPattern(pattern_id, pattern);
+        vector<string> forward;
+        TdokuEnumerate(pattern, 100000, [](const char *grid, void *arg) {
+            static_cast<vector<string> *>(arg)->emplace_back(grid, 81);
+        }, &forward);
+        size_t n = forward.size();
+        for (size_t k = 1; k <= n; k = (k == 32 && n > 64) ? n - 31 : k + 1) {
+            char solution[81];
+            size_t guesses;
+            size_t count = TdokuSolveReverse(pattern, k, solution, &guesses);
+            bool this_fail = count != k || string(solution, 81) != forward[n - k];
+            if (this_fail) {
+                cout << "FAIL: tdoku reverse order\n"
+                     << "      pattern:  " << pattern_id << ", solution " << k << " of " << n
+                     << " from the end\n"
+                     << "      expected: " << forward[n - k] << "\n"
+                     << "      observed: " << count << " " << string(solution, 81) << endl;
+            }
+            fail |= this_fail;
+        }
+        if (verbose) cout << "tdoku reverse order: pattern " << pattern_id << ", " << n
+                          << " solutions" << endl;
+    }
+    if (!fail) cout << "PASS: tdoku reverse order" << endl;
+}
+
+// LocateGrid against the linear walk the original grid.index format was read with, over a
+// synthetic grid.counts spanning several index blocks, with runs of empty patterns at the
+// start, across group and block boundaries and at the end. the original format is checked too.
+void RunGridIndex(bool verbose) {
+    const size_t kNumPatterns = 3 * 4096 + 100;
+    vector<uint16_t> counts(kNumPatterns);
+    uint32_t x = 1;
+    for (size_t i = 0; i < kNumPatterns; i++) {
+        x = x * 1664525u + 1013904223u;
+        bool empty = i < 3 || i % 7 == 0 || (i >= 4090 && i < 4200) ||
+                     (i >= 8190 && i < 8193) || (i >= 127 && i < 129) || i + 5 >= kNumPatterns;
+        counts[i] = empty ? 0 : (uint16_t) (x >> 24u);
+    }
+    counts[5000] = 65535;
+
+    vector<char> index(GridIndexSize(kNumPatterns));
+    MakeGridIndex(counts.data(), kNumPatterns, index.data());
+    // the original format: a pattern id and an offset into it for every 2^20th grid.
+    vector<char> old_index;
+    size_t pattern_idx = 0, to_skip = 0;
+    bool fail = false;
+    for (size_t grid_idx = 0; pattern_idx < kNumPatterns; grid_idx++) {
+        // the walk: the next grid is the next solution of this pattern, or the first of the next
+        // non-empty one.
+        while (pattern_idx < kNumPatterns && to_skip >= counts[pattern_idx]) {
+            pattern_idx++;
+            to_skip = 0;
+        }
+        if (pattern_idx == kNumPatterns) break;
+        if (grid_idx % (1u << 20u) == 0) {
+            auto entry = (uint32_t) pattern_idx;
+            auto offset = (uint16_t) to_skip;
+            old_index.insert(old_index.end(), (char *) &entry, (char *) &entry + 4);
+            old_index.insert(old_index.end(), (char *) &offset, (char *) &offset + 2);
+        }
+        size_t located_pattern, located_skip;
+        LocateGrid(grid_idx, index.data(), counts.data(), &located_pattern, &located_skip);
+        bool this_fail = located_pattern != pattern_idx || located_skip != to_skip;
+        // the original format walks up to a million grids per lookup, so it's only sampled.
+        if (grid_idx % 101 == 0) {
+            LocateGrid(grid_idx, old_index.data(), counts.data(), &located_pattern,
+                       &located_skip);
+            this_fail |= located_pattern != pattern_idx || located_skip != to_skip;
+        }
+        if (this_fail) {
+            cout << "FAIL: grid index\n"
+                 << "      grid:     " << grid_idx << "\n"
+                 << "      expected: pattern " << pattern_idx << ", skip " << to_skip << endl;
+            fail = true;
+            break;
+        }
+        to_skip++;
+    }
+    if (verbose) cout << "grid index: " << kNumPatterns << " patterns" << endl;
+    if (!fail) cout << "PASS: grid index" << endl;
+}
+
+// TdokuMinimizeBatch minimizes each puzzle as TdokuMinimize does after reseeding with the
+// puzzle's derived seed, whatever the number of threads, and leaves it unique and minimal.
+// the unique test puzzles and their solutions are minimized as vanilla and pencilmark sudokus.
+void RunTdokuMinimizeBatch(const string &testdata_filename, bool verbose) {
+    const uint64_t kSeed = 12345;
+    ifstream file(testdata_filename);
+    string line;
+    vector<string> inputs;
+    while (getline(file, line)) {
+        stringstream ss(line);
+        string puzzle, expect_str, solution;
+        getline(ss, puzzle, ':');
+        getline(ss, expect_str, ':');
+        getline(ss, solution, ':');
+        if (expect_str != "1") continue;
+        inputs.push_back(puzzle);
+        inputs.push_back(solution);
+    }
+    bool fail = false;
+    for (bool pencilmark : {false, true}) {
+        size_t stride = pencilmark ? 729 : 81;
+        string puzzles;
+        for (const string &input : inputs) {
+            if (!pencilmark) {
+                puzzles += input;
+                continue;
+            }
+            for (int cell = 0; cell < 81; cell++) {
+                for (int digit = 0; digit < 9; digit++) {
+                    bool allowed = input[cell] == '.' || input[cell] == '1' + digit;
+                    puzzles += allowed ? (char) ('1' + digit) : '.';
+                }
+            }
+        }
+        size_t n = inputs.size();
+        string expected = puzzles;
+        for (size_t i = 0; i < n; i++) {
+            TdokuRandomSeed(SplitMix64(kSeed + i));
+            TdokuMinimize(pencilmark, false, &expected[i * stride]);
+        }
+        for (int num_threads : {1, 4}) {
+            string observed = puzzles;
+            TdokuMinimizeBatch(pencilmark, false, n, &observed[0], nullptr, num_threads, kSeed);
+            for (size_t i = 0; i < n; i++) {
+                string puzzle = observed.substr(i * stride, stride);
+                bool this_fail = puzzle != expected.substr(i * stride, stride);
+                if (this_fail) {
+                    cout << "FAIL: tdoku minimize batch\n"
+                         << "      puzzle:   " << inputs[i] << (pencilmark ? " (pencilmark)" : "")
+                         << ", " << num_threads << " threads\n"
+                         << "      expected: " << expected.substr(i * stride, stride) << "\n"
+                         << "      observed: " << puzzle << endl;
+                }
+                fail |= this_fail;
+            }
+        }
+        // unique, and removing any remaining clue (a digit, or for pencilmark an eliminated
+        // candidate) admits a second solution.
+        for (size_t i = 0; i < n; i++) {
+            string puzzle = expected.substr(i * stride, stride);
+            char solution[81];
+            size_t guesses;
+            bool this_fail = TdokuSolverDpllTriadSimd(puzzle.c_str(), 2, 0, solution, &guesses) != 1;
+            for (size_t j = 0; j < stride && !this_fail; j++) {
+                if (pencilmark != (puzzle[j] == '.')) continue;
+                string relaxed = puzzle;
+                relaxed[j] = pencilmark ? (char) ('1' + j % 9) : '.';
+                this_fail = TdokuSolverDpllTriadSimd(relaxed.c_str(), 2, 0, solution, &guesses) != 2;
+            }
+            if (this_fail || verbose) {
+                cout << (this_fail ? "FAIL: " : "") << "tdoku minimize batch minimal\n"
+                     << "      puzzle:   " << inputs[i] << (pencilmark ? " (pencilmark)" : "")
+                     << "\n"
+                     << "      observed: " << puzzle << endl;
+            }
+            fail |= this_fail;
+        }
+    }
+    if (!fail) cout << "PASS: tdoku minimize batch" << endl;
+}
+
+// Util::PermuteSudoku against the per-cell loop it replaced, drawing the same permutations from
+// an identically seeded generator, for the test puzzles and their solutions as vanilla sudokus
+// and for random candidate sets as pencilmark ones.
+void PermuteSudokuPerCell(uint64_t seed, char *puzzle, bool pencilmark) {
+    mt19937_64 rng(seed);
+    auto block_shuffle = [&](array<int, 9> *vec) {
+        array<int, 3> blocks{0, 1, 2};
+        shuffle(blocks.begin(), blocks.end(), rng);
+        for (int i = 0; i < 3; i++) {
+            array<int, 3> block{0, 1, 2};
+            shuffle(block.begin(), block.end(), rng);
+            for (int j = 0; j < 3; j++) (*vec)[i * 3 + j] = blocks[i] * 3 + block[j];
+        }
+    };
+    array<int, 9> digit_permutation{0, 1, 2, 3, 4, 5, 6, 7, 8};
+    shuffle(digit_permutation.begin(), digit_permutation.end(), rng);
+    array<int, 9> row_permutation{0, 1, 2, 3, 4, 5, 6, 7, 8};
+    array<int, 9> col_permutation{0, 1, 2, 3, 4, 5, 6, 7, 8};
+    block_shuffle(&col_permutation);
+    block_shuffle(&row_permutation);
+
+    size_t row_size = pencilmark ? 81 : 9;
+    vector<char> out_puzzle(row_size * 9);
+    for (int row = 0; row < 9; row++) {
+        for (int col = 0; col < 9; col++) {
+            if (pencilmark) {
+                for (int digit = 0; digit < 9; digit++) {
+                    bool eliminated = puzzle[row * 81 + col * 9 + digit] == '.';
+                    out_puzzle[row_permutation[row] * 81 + col_permutation[col] * 9 +
+                               digit_permutation[digit]] =
+                            eliminated ? '.' : (char) ('1' + digit_permutation[digit]);
+                }
+            } else {
+                char digit = puzzle[row * 9 + col];
+                if (digit != '.') digit = (char) ('1' + digit_permutation[digit - '1']);
+                out_puzzle[row_permutation[row] * 9 + col_permutation[col]] = digit;
+            }
+        }
+    }
+    memcpy(puzzle, out_puzzle.data(), out_puzzle.size());
+}
+
+void RunPermuteSudoku(const string &testdata_filename, bool verbose) {
+    ifstream file(testdata_filename);
+    string line;
+    vector<string> vanilla;
+    while (getline(file, line)) {
+        stringstream ss(line);
+        string puzzle, expect_str, solution;
+        getline(ss, puzzle, ':');
+        getline(ss, expect_str, ':');
+        getline(ss, solution, ':');
+        vanilla.push_back(puzzle);
+        if (solution.size() == 81) vanilla.push_back(solution);
+    }
+    vector<string> pencilmark;
+    mt19937_64 rng(1);
+    for (int i = 0; i < 32; i++) {
+        string puzzle(729, '.');
+        for (size_t j = 0; j < 729; j++) {
+            if (rng() % 4 < (uint64_t) i % 4) puzzle[j] = (char) ('1' + j % 9);
+        }
+        pencilmark.push_back(puzzle);
+    }
+    bool fail = false;
+    Util util;
+    for (bool is_pencilmark : {false, true}) {
+        uint64_t seed = 0;
+        for (const string &puzzle : is_pencilmark ? pencilmark : vanilla) {
+            for (int k = 0; k < 4; k++, seed++) {
+                string expected = puzzle, observed = puzzle;
+                PermuteSudokuPerCell(seed, &expected[0], is_pencilmark);
+                util.RandomSeed(seed);
+                util.PermuteSudoku(&observed[0], is_pencilmark);
+                bool this_fail = observed != expected;
+                if (this_fail) {
+                    cout << "FAIL: util permute sudoku\n"
+                         << "      puzzle:   " << puzzle << ", seed " << seed << "\n"
+                         << "      expected: " << expected << "\n"
+                         << "      observed: " << observed << endl;
+                }
+                fail |= this_fail;
+            }
+        }
+        if (verbose) cout << "util permute sudoku: " << seed << (is_pencilmark ? " pencilmark" : "")
+                          << " permutations" << endl;
+    }
+    if (!fail) cout << "PASS: util permute sudoku" << endl;
+}
+
+// the 16x16 and 25x25 lab solvers take one board size each, so rather than test_puzzles they
+// get a few cases built from one unique puzzle: the puzzle as given and in pencilmark form, the
+// puzzle with its first band cleared (more than one solution, since any two of the band's rows
+// can then be swapped) and the puzzle with a clue repeated in its first row.
+const char *kSymbols = "123456789ABCDEFGHIJKLMNOP";
+const char *kPuzzle16 =
+    "..D...B43.862..9.8..DF...9....7B......9A...D638CA...6...4.....F."
+    ".....9...E1856C3.18.F.4G..C....A2...5......F.D.........D.A9....."
+    ".3.6.E..72.B1...7..2.3...G41...D.....A2.....95..8E..1...56..B..."
+    "..E.....C....9..9..5.D8....4E.GFC......1..6A..27..4..65...G..C.8";
+const char *kPuzzle25 =
+    "AGP23.I..H4..J18....59..78OEN...14.596...C.H.P32...F.....A32K.EN..65.7H.LIB"
+    "9.75M.O8..H..B..AP2....D..IBH..6.M5..GP.1DJ...8..E3AG....L.B.1DF4...NO.M..."
+    "K8OEND.4J..M..5H...CG.P.AL.IBH69..7.3A.....JD....O.DFJ.GA..PN.O.K.97..BL.C."
+    "..6....K.EB.CI...G....J.D.7.M9NE...LIB.....3P4.1F..P23.HB..L....DO.K8..6.7."
+    "FJ4.D2PGA3...KO67..5.ICBHOE...J.D......9.IH.....GP...LC..6....P2AD.41J..8EN"
+    "EN.8O4.....75M.IB.C..G..2J41DF.2....NK8.7...M.B....H..I.5.69..23.F.1.4....K"
+    "75M....E.8..H.IG.3.2.F.J.P..AG...I.D...FEN...9.6..5M9..8..E...LC.P2AG3D..41"
+    "41.FJ.3..G...ON....9.H...23..P.LH.IF4.D.N.OE...7M9...IB9.5..G2...J.DF1ON..8"
+    "...O.1.JFD65M97B..IL...23";
+
+// whether solution is a full grid that agrees with the puzzle's clues.
+bool ValidLargeSolution(const string &puzzle, const string &solution, int box_dim) {
+    int side = box_dim * box_dim;
+    vector<uint32_t> row_seen(side), col_seen(side), box_seen(side);
+    for (int cell = 0; cell < side * side; cell++) {
+        auto symbol = (const char *) memchr(kSymbols, solution[cell], side);
+        if (symbol == nullptr) return false;
+        if (puzzle[cell] != '.' && puzzle[cell] != solution[cell]) return false;
+        int row = cell / side, col = cell % side, box = row / box_dim * box_dim + col / box_dim;
+        uint32_t bit = 1u << (uint32_t) (symbol - kSymbols);
+        if ((row_seen[row] | col_seen[col] | box_seen[box]) & bit) return false;
+        row_seen[row] |= bit;
+        col_seen[col] |= bit;
+        box_seen[box] |= bit;
+    }
+    return true;
+}
+
+void RunLargeBoard(const char *id, SolverFn *solve, const string &puzzle, int box_dim,
+                   bool verbose) {
+    int side = box_dim * box_dim;
+    string pencilmark;
+    for (char clue : puzzle) {
+        for (int value = 0; value < side; value++) {
+            pencilmark += clue == '.' || clue == kSymbols[value] ? kSymbols[value] : '.';
+        }
+    }
+    string cleared = string(side * box_dim, '.') + puzzle.substr(side * box_dim);
+    string repeated = puzzle;
+    size_t first_clue = puzzle.find_first_not_of('.');
+    size_t first_empty = puzzle.find('.');
+    if (first_clue < (size_t) side && first_empty < (size_t) side) {
+        repeated[first_empty] = puzzle[first_clue];
+    }
+    struct Case { string input; size_t expect; };
+    vector<Case> cases{{puzzle, 1}, {pencilmark, 1}, {cleared, 2}, {repeated, 0}};
+
+    bool fail = false;
+    // each case with and without the singles pre-pass (configuration bit 3).
+    for (uint32_t configuration : {3u, 11u}) {
+        for (const Case &c : cases) {
+            string output(side * side + 1, '\0');
+            size_t guesses;
+            size_t count = solve(c.input.c_str(), 2, configuration, &output[0], &guesses);
+            bool this_fail = count != c.expect ||
+                             (c.expect == 1 && !ValidLargeSolution(puzzle, output, box_dim));
+            if (this_fail || verbose) {
+                cout << (this_fail ? "FAIL: " : "") << id << " configuration " << configuration
+                     << "\n"
+                     << "      puzzle:   " << c.input << "\n"
+                     << "      expected: " << c.expect << "\n"
+                     << "      observed: " << count << " " << output.c_str() << endl;
+            }
+            fail |= this_fail;
+        }
+    }
+    if (!fail) cout << "PASS: " << id << endl;
+}
+
 int main(int argc, char **argv) {
     bool verbose = false;
     string testdata_filename = "test/test_puzzles";
@@ -71,7 +588,22 @@ int main(int argc, char **argv) {
     }
 
     auto solvers = GetAllSolvers();
+    // with runtime dispatch, also test each instruction set build the host can run.
+    if (TdokuNumIsaVariants() > 1) {
+        for (auto &solver : GetIsaVariantSolvers()) solvers.push_back(solver);
+    }
     for (auto &solver : solvers) {
         Run(testdata_filename, solver, verbose);
     }
+    RunDrakeBatch(testdata_filename, 1, 3, verbose);
+    RunDrakeBatch(testdata_filename, 5, 3, verbose);
+    RunDrakeBatch(testdata_filename, 5, 11, verbose);
+    RunDrakeCount(testdata_filename, verbose);
+    RunDrakeBudget(testdata_filename, verbose);
+    RunTdokuReverse(verbose);
+    RunGridIndex(verbose);
+    RunTdokuMinimizeBatch(testdata_filename, verbose);
+    RunPermuteSudoku(testdata_filename, verbose);
+    RunLargeBoard("drake/triad_scc_16x16", DrakeSolverTriadScc16, kPuzzle16, 4, verbose);
+    RunLargeBoard("drake/triad_scc_25x25", DrakeSolverTriadScc25, kPuzzle25, 5, verbose);
 }